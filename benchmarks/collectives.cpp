@@ -0,0 +1,312 @@
+
+#include "mpi.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/// Latency benchmark of the wrappers over a range of message sizes.  Each
+/// operation is repeated and the slowest process time of every repetition is
+/// recorded, from which the median and tail latencies are reported as comma
+/// separated values.  Run the executable with several process counts, for
+/// example through the collectives_benchmark tests, to sweep the rank count.
+///
+///     mpirun -np 4 collectives_benchmark --output results.csv
+///            --baseline baseline.csv --tolerance 0.25
+///
+/// The whole sweep is run several times and the round with the lowest median
+/// is kept for each measurement.  With a baseline the median latencies are
+/// compared with the stored ones and the executable fails if any is slower
+/// than the tolerance allows.  When the baseline file does not exist the
+/// sweep is not run and the executable returns baseline_missing, which the
+/// tests report as skipped.  Without --baseline the results are only recorded.
+
+namespace
+{
+/// Exit code when the baseline to compare with has not been recorded
+constexpr int baseline_missing = 77;
+
+struct options
+{
+    std::string output;
+    std::string baseline;
+    double tolerance = 0.25;
+    /// Differences below this many microseconds are treated as noise
+    double noise_floor = 5.0;
+    std::size_t max_bytes = 1 << 18;
+    int repetitions = 50;
+    /// The sweep is repeated and the round with the lowest median is kept
+    int rounds = 3;
+};
+
+options parse(int argc, char* argv[])
+{
+    options parsed;
+
+    for (int argument = 1; argument + 1 < argc; argument += 2)
+    {
+        if (std::strcmp(argv[argument], "--output") == 0)
+        {
+            parsed.output = argv[argument + 1];
+        }
+        else if (std::strcmp(argv[argument], "--baseline") == 0)
+        {
+            parsed.baseline = argv[argument + 1];
+        }
+        else if (std::strcmp(argv[argument], "--tolerance") == 0)
+        {
+            parsed.tolerance = std::atof(argv[argument + 1]);
+        }
+        else if (std::strcmp(argv[argument], "--noise-floor") == 0)
+        {
+            parsed.noise_floor = std::atof(argv[argument + 1]);
+        }
+        else if (std::strcmp(argv[argument], "--max-bytes") == 0)
+        {
+            parsed.max_bytes = std::atoll(argv[argument + 1]);
+        }
+        else if (std::strcmp(argv[argument], "--repetitions") == 0)
+        {
+            parsed.repetitions = std::max(1, std::atoi(argv[argument + 1]));
+        }
+        else if (std::strcmp(argv[argument], "--rounds") == 0)
+        {
+            parsed.rounds = std::max(1, std::atoi(argv[argument + 1]));
+        }
+    }
+    return parsed;
+}
+
+/// Latencies of one operation and message size in microseconds
+struct measurement
+{
+    std::string operation;
+    int processes;
+    std::size_t bytes;
+    int repetitions;
+    double median, p90, p99, max;
+};
+
+/// Time each repetition of \p operation and summarise the slowest process
+template <typename Operation_Tp>
+measurement time_operation(std::string const& name,
+                           std::size_t const bytes,
+                           options const& settings,
+                           Operation_Tp&& operation)
+{
+    // Warm up the connections and any internal buffers
+    operation();
+
+    std::vector<double> local_times(settings.repetitions);
+
+    for (auto& local_time : local_times)
+    {
+        mpi::barrier();
+
+        auto const start = MPI_Wtime();
+        operation();
+        local_time = 1.0e6 * (MPI_Wtime() - start);
+    }
+
+    auto times = mpi::all_reduce(local_times, mpi::max{});
+
+    std::sort(begin(times), end(times));
+
+    auto const percentile = [&](double const fraction) {
+        return times[static_cast<std::size_t>(fraction * (times.size() - 1) + 0.5)];
+    };
+
+    return {name,
+            mpi::size(),
+            bytes,
+            settings.repetitions,
+            percentile(0.5),
+            percentile(0.9),
+            percentile(0.99),
+            times.back()};
+}
+
+std::vector<measurement> run_sweep(options const& settings)
+{
+    std::vector<measurement> results;
+
+    auto const last = mpi::size() - 1;
+
+    for (std::size_t bytes = sizeof(double); bytes <= settings.max_bytes; bytes *= 8)
+    {
+        auto const count = bytes / sizeof(double);
+
+        std::vector<double> data(count, mpi::rank());
+
+        if (mpi::size() > 1)
+        {
+            // Round trip between the first and the last process
+            results.push_back(time_operation("send_receive", bytes, settings, [&] {
+                if (mpi::rank() == 0)
+                {
+                    mpi::send(mpi::blocking{}, data, last);
+                    data = mpi::receive<std::vector<double>>(last);
+                }
+                else if (mpi::rank() == last)
+                {
+                    data = mpi::receive<std::vector<double>>(0);
+                    mpi::send(mpi::blocking{}, data, 0);
+                }
+            }));
+        }
+
+        results.push_back(
+            time_operation("broadcast", bytes, settings, [&] { data = mpi::broadcast(data); }));
+
+        results.push_back(time_operation("reduce", bytes, settings, [&] {
+            auto const reduced = mpi::reduce(data, mpi::sum{});
+        }));
+
+        results.push_back(time_operation("all_reduce", bytes, settings, [&] {
+            auto const reduced = mpi::all_reduce(data, mpi::sum{});
+        }));
+
+        // Every process sends the message size in total
+        std::vector<double> blocks(std::max<std::size_t>(count / mpi::size(), 1) * mpi::size());
+
+        results.push_back(time_operation("all_to_all", bytes, settings, [&] {
+            blocks = mpi::all_to_all(blocks);
+        }));
+
+        results.push_back(time_operation("gather", bytes, settings, [&] {
+            auto const gathered = mpi::gather(data, 0);
+        }));
+    }
+    return results;
+}
+
+std::string to_csv(std::vector<measurement> const& results)
+{
+    std::ostringstream csv;
+
+    csv << "operation,processes,bytes,repetitions,median_us,p90_us,p99_us,max_us\n";
+
+    for (auto const& result : results)
+    {
+        csv << result.operation << ',' << result.processes << ',' << result.bytes << ','
+            << result.repetitions << ',' << result.median << ',' << result.p90 << ','
+            << result.p99 << ',' << result.max << '\n';
+    }
+    return csv.str();
+}
+
+using measurement_key = std::tuple<std::string, int, std::size_t>;
+
+/// \return The median latencies of a results file, empty if it does not exist
+std::map<measurement_key, double> read_medians(std::string const& file_name)
+{
+    std::map<measurement_key, double> medians;
+
+    std::ifstream file(file_name);
+
+    std::string line;
+    std::getline(file, line);
+
+    while (std::getline(file, line))
+    {
+        std::replace(begin(line), end(line), ',', ' ');
+        std::istringstream fields(line);
+
+        std::string operation;
+        int processes, repetitions;
+        std::size_t bytes;
+        double median;
+
+        if (fields >> operation >> processes >> bytes >> repetitions >> median)
+        {
+            medians[measurement_key{operation, processes, bytes}] = median;
+        }
+    }
+    return medians;
+}
+
+/// \return The number of measurements slower than the baseline allows
+int compare(std::vector<measurement> const& results, options const& settings)
+{
+    auto const baseline = read_medians(settings.baseline);
+
+    int regressions = 0;
+
+    for (auto const& result : results)
+    {
+        auto const stored = baseline.find(
+            measurement_key{result.operation, result.processes, result.bytes});
+
+        if (stored == end(baseline)) continue;
+
+        if (result.median > stored->second * (1.0 + settings.tolerance)
+            && result.median - stored->second > settings.noise_floor)
+        {
+            std::printf("# regression %s processes %d bytes %zu median %.2f us baseline %.2f us\n",
+                        result.operation.c_str(),
+                        result.processes,
+                        result.bytes,
+                        result.median,
+                        stored->second);
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    mpi::instance instance(argc, argv);
+
+    auto const settings = parse(argc, argv);
+
+    if (!settings.baseline.empty())
+    {
+        int has_baseline = mpi::rank() == 0 && !read_medians(settings.baseline).empty();
+        has_baseline = mpi::broadcast(has_baseline);
+
+        if (!has_baseline)
+        {
+            if (mpi::rank() == 0)
+            {
+                std::printf("# no baseline in %s, record it with the benchmark_baseline "
+                            "target\n",
+                            settings.baseline.c_str());
+            }
+            return baseline_missing;
+        }
+    }
+
+    // Keeping the best round filters out interference from other programs
+    auto results = run_sweep(settings);
+
+    for (int round = 1; round < settings.rounds; ++round)
+    {
+        auto const repeated = run_sweep(settings);
+
+        for (std::size_t index = 0; index < results.size(); ++index)
+        {
+            if (repeated[index].median < results[index].median) results[index] = repeated[index];
+        }
+    }
+
+    if (mpi::rank() != 0) return 0;
+
+    auto const csv = to_csv(results);
+
+    std::printf("%s", csv.c_str());
+
+    if (!settings.output.empty()) std::ofstream(settings.output) << csv;
+
+    if (!settings.baseline.empty() && compare(results, settings) > 0) return 1;
+
+    return 0;
+}
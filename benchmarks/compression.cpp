@@ -0,0 +1,119 @@
+
+#include "mpi.hpp"
+#include "mpi/compression.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/// Ping-pong benchmark comparing raw and compressed vector transfers between
+/// processes 0 and 1 over a range of message sizes.  The crossover point is the
+/// first size where a compressed transfer beats the raw transfer.
+
+namespace
+{
+constexpr int repetitions = 20;
+
+/// Smooth field data similar to a solution vector from a simulation
+std::vector<double> make_field(std::size_t const size)
+{
+    std::vector<double> field(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        field[i] = 300.0 + std::round(1.0e4 * std::sin(1.0e-3 * static_cast<double>(i))) * 1.0e-4;
+    }
+    return field;
+}
+
+/// \return The mean round trip time in seconds
+template <typename Send, typename Receive>
+double ping_pong(Send&& send, Receive&& receive)
+{
+    mpi::barrier();
+
+    auto const start = std::chrono::steady_clock::now();
+
+    for (int repetition = 0; repetition < repetitions; ++repetition)
+    {
+        if (mpi::rank() == 0)
+        {
+            send(1);
+            receive(1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            receive(0);
+            send(0);
+        }
+    }
+
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    return mpi::broadcast(elapsed.count() / repetitions);
+}
+}
+
+int main(int argc, char* argv[])
+{
+    mpi::instance instance(argc, argv);
+
+    if (mpi::size() < 2)
+    {
+        std::fprintf(stderr, "compression benchmark requires at least two processes\n");
+        return 1;
+    }
+
+    if (mpi::rank() == 0)
+    {
+        std::printf("%12s %12s %12s %12s %10s %10s\n",
+                    "bytes",
+                    "raw (us)",
+                    "rle (us)",
+                    "lz (us)",
+                    "rle ratio",
+                    "lz ratio");
+    }
+
+    for (std::size_t size = 1 << 10; size <= (1 << 22); size <<= 2)
+    {
+        auto const field = make_field(size);
+
+        auto const raw_time = ping_pong(
+            [&](int process) { mpi::send(mpi::blocking{}, field, process); },
+            [](int process) { mpi::receive<std::vector<double>>(process); });
+
+        double times[2], ratios[2];
+
+        mpi::codec const methods[2] = {mpi::codec::run_length, mpi::codec::lz};
+
+        for (int index = 0; index < 2; ++index)
+        {
+            mpi::compressed const options{0, methods[index]};
+
+            times[index] = ping_pong([&](int process) { mpi::send(options, field, process); },
+                                     [](int process) {
+                                         mpi::receive<std::vector<double>>(mpi::compressed{},
+                                                                           process);
+                                     });
+
+            auto const message = mpi::detail::compress_message(field.data(),
+                                                               field.size(),
+                                                               sizeof(double),
+                                                               options);
+            ratios[index] = static_cast<double>(field.size() * sizeof(double)) / message.size();
+        }
+
+        if (mpi::rank() == 0)
+        {
+            std::printf("%12zu %12.1f %12.1f %12.1f %10.2f %10.2f\n",
+                        size * sizeof(double),
+                        raw_time * 1.0e6,
+                        times[0] * 1.0e6,
+                        times[1] * 1.0e6,
+                        ratios[0],
+                        ratios[1]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+
+#include "mpi.hpp"
+#include "mpi/sort.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/// Scaling benchmark for the distributed sample sort.  For weak scaling each
+/// process sorts a fixed number of keys, for strong scaling the total number
+/// of keys is fixed and divided over the processes.  Run the executable with
+/// an increasing number of processes to obtain a scaling curve, e.g.
+///
+///     for np in 1 2 4 8; do mpirun -np $np sort_benchmark weak 1000000; done
+///
+/// One line is printed per run with the slowest process time for each phase.
+
+int main(int argc, char* argv[])
+{
+    mpi::instance instance(argc, argv);
+
+    bool const is_strong = argc > 1 && std::strcmp(argv[1], "strong") == 0;
+
+    long long const keys = argc > 2 ? std::atoll(argv[2]) : 1 << 22;
+
+    long long const local_keys = is_strong ? keys / mpi::size()
+                                                 + (mpi::rank() < keys % mpi::size() ? 1 : 0)
+                                           : keys;
+
+    constexpr int repetitions = 5;
+
+    std::mt19937_64 generator(mpi::rank());
+    std::uniform_int_distribution<long long> distribution;
+
+    std::vector<long long> data;
+
+    mpi::sample_sorter<long long> sorter;
+
+    // Slowest process for each phase, summed over the repetitions
+    std::vector<double> phase_times(6, 0.0);
+
+    for (int repetition = 0; repetition < repetitions; ++repetition)
+    {
+        data.resize(local_keys);
+        std::generate(begin(data), end(data), [&] { return distribution(generator); });
+
+        mpi::barrier();
+
+        sorter.sort(data);
+
+        auto const& timings = sorter.timings();
+
+        std::vector<double> const local_times{timings.local_sort,
+                                              timings.sampling,
+                                              timings.partition,
+                                              timings.exchange,
+                                              timings.merge,
+                                              timings.total()};
+
+        auto const slowest = mpi::all_reduce(local_times, mpi::max{});
+
+        std::transform(begin(phase_times),
+                       end(phase_times),
+                       begin(slowest),
+                       begin(phase_times),
+                       std::plus<double>());
+    }
+
+    auto const total_keys = mpi::all_reduce(local_keys, mpi::sum{});
+
+    auto const max_imbalance = mpi::all_reduce(static_cast<double>(data.size()), mpi::max{})
+                               / (static_cast<double>(total_keys) / mpi::size());
+
+    if (mpi::rank() == 0)
+    {
+        std::printf("# scaling processes keys local_sort sampling partition exchange merge total "
+                    "keys_per_second imbalance\n");
+        std::printf("%s %d %lld",
+                    is_strong ? "strong" : "weak",
+                    mpi::size(),
+                    total_keys);
+        for (auto const phase_time : phase_times)
+        {
+            std::printf(" %.6f", phase_time / repetitions);
+        }
+        std::printf(" %.3e %.3f\n", total_keys / (phase_times.back() / repetitions), max_imbalance);
+    }
+    return 0;
+}
@@ -1,9 +1,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
 #include <mpi.h>
 
 /// \file mpi.hpp
@@ -58,6 +72,19 @@ inline void barrier(communicator const comm = communicator::world)
     MPI_Barrier(comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
 }
 
+/// \return The largest message tag supported by the library (\p MPI_TAG_UB),
+/// which is at least 32767.  The attribute is only queried on the first call.
+inline int tag_upper_bound()
+{
+    static int const upper_bound = [] {
+        int* value = nullptr;
+        int is_set = 0;
+        MPI_Comm_get_attr(MPI_COMM_WORLD, MPI_TAG_UB, &value, &is_set);
+        return is_set ? *value : 32767;
+    }();
+    return upper_bound;
+}
+
 /*----------------------------------------------------------------------------*
  *                  Reduction operations for MPI data types                   *
  *----------------------------------------------------------------------------*/
@@ -94,51 +121,324 @@ struct prod
  *               Template specialisations for MPI data types                  *
  *----------------------------------------------------------------------------*/
 
+/// data_type maps a C++ type to its MPI datatype.  Every built-in arithmetic
+/// type is covered, so the fixed width integers (std::int8_t to
+/// std::uint64_t) map through the type they alias.  The handles of some MPI
+/// libraries are addresses of library objects and cannot be constant
+/// expressions, so detail::has_data_type is the compile time query.
 template <class T>
 struct data_type;
 
+template <>
+struct data_type<bool>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_CXX_BOOL; }
+};
+
+template <>
+struct data_type<char>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_CHAR; }
+};
+
+template <>
+struct data_type<signed char>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_SIGNED_CHAR; }
+};
+
+template <>
+struct data_type<unsigned char>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_UNSIGNED_CHAR; }
+};
+
+template <>
+struct data_type<wchar_t>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_WCHAR; }
+};
+
+template <>
+struct data_type<short>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_SHORT; }
+};
+
+template <>
+struct data_type<unsigned short>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_UNSIGNED_SHORT; }
+};
+
 template <>
 struct data_type<int>
 {
-    static MPI_Datatype value_type() { return MPI_INT; }
+    static MPI_Datatype value_type() noexcept { return MPI_INT; }
+};
+
+template <>
+struct data_type<unsigned int>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_UNSIGNED; }
 };
 
 template <>
 struct data_type<long int>
 {
-    static MPI_Datatype value_type() { return MPI_LONG_INT; }
+    static MPI_Datatype value_type() noexcept { return MPI_LONG; }
+};
+
+template <>
+struct data_type<unsigned long int>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_UNSIGNED_LONG; }
 };
 
 template <>
 struct data_type<long long int>
 {
-    static MPI_Datatype value_type() { return MPI_LONG_LONG_INT; }
+    static MPI_Datatype value_type() noexcept { return MPI_LONG_LONG_INT; }
 };
 
 template <>
-struct data_type<char>
+struct data_type<unsigned long long int>
 {
-    static MPI_Datatype value_type() { return MPI_CHAR; }
+    static MPI_Datatype value_type() noexcept { return MPI_UNSIGNED_LONG_LONG; }
 };
 
 template <>
 struct data_type<float>
 {
-    static MPI_Datatype value_type() { return MPI_FLOAT; }
+    static MPI_Datatype value_type() noexcept { return MPI_FLOAT; }
 };
 
 template <>
 struct data_type<double>
 {
-    static MPI_Datatype value_type() { return MPI_DOUBLE; }
+    static MPI_Datatype value_type() noexcept { return MPI_DOUBLE; }
 };
 
 template <>
 struct data_type<long double>
 {
-    static MPI_Datatype value_type() { return MPI_LONG_DOUBLE; }
+    static MPI_Datatype value_type() noexcept { return MPI_LONG_DOUBLE; }
+};
+
+template <>
+struct data_type<std::complex<float>>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_CXX_FLOAT_COMPLEX; }
+};
+
+template <>
+struct data_type<std::complex<double>>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_CXX_DOUBLE_COMPLEX; }
+};
+
+template <>
+struct data_type<std::complex<long double>>
+{
+    static MPI_Datatype value_type() noexcept { return MPI_CXX_LONG_DOUBLE_COMPLEX; }
+};
+
+/// Base of the data_type of a fixed size aggregate of \p N values of
+/// \p Element_Tp without padding, for example a point with three coordinates
+///
+///     namespace mpi
+///     {
+///     template <>
+///     struct data_type<point> : contiguous_data_type<double, 3>
+///     {
+///     };
+///     }
+///
+/// The contiguous type is created and committed on first use and then kept
+/// until MPI is finalised, so vectors of aggregates are sent in one call.
+template <typename Element_Tp, std::size_t N>
+struct contiguous_data_type
+{
+    static MPI_Datatype value_type()
+    {
+        static MPI_Datatype const contiguous = [] {
+            MPI_Datatype type;
+            MPI_Type_contiguous(N, data_type<Element_Tp>::value_type(), &type);
+            MPI_Type_commit(&type);
+            return type;
+        }();
+        return contiguous;
+    }
+};
+
+template <typename T, std::size_t N>
+struct data_type<std::array<T, N>> : contiguous_data_type<T, N>
+{
+    static_assert(sizeof(std::array<T, N>) == N * sizeof(T), "std::array must not be padded");
+};
+
+namespace detail
+{
+template <typename... Ts>
+struct make_void
+{
+    using type = void;
+};
+
+template <typename... Ts>
+using void_t = typename make_void<Ts...>::type;
+
+/// true if data_type is specialised for \p T
+template <typename T, typename = void>
+struct has_data_type : std::false_type
+{
+};
+
+template <typename T>
+struct has_data_type<T, void_t<decltype(data_type<T>::value_type())>> : std::true_type
+{
+};
+
+/// true if \p T is a contiguous container, such as a std::vector, of values
+/// with a data_type and is not itself sent as a single value
+template <typename T, typename = void>
+struct is_container : std::false_type
+{
+};
+
+template <typename T>
+struct is_container<T, void_t<typename T::value_type>>
+    : std::integral_constant<bool,
+                             has_data_type<typename T::value_type>::value
+                                 && !has_data_type<T>::value>
+{
+};
+}
+
+/*----------------------------------------------------------------------------*
+ *                            Derived data types                              *
+ *----------------------------------------------------------------------------*/
+
+/// Storage order of a multidimensional array \sa make_subarray()
+enum class array_order : int { row_major = MPI_ORDER_C, column_major = MPI_ORDER_FORTRAN };
+
+/// derived_type owns a committed derived MPI datatype and frees it when it
+/// goes out of scope.  Objects must be destroyed before the MPI environment is
+/// finalised.
+class derived_type
+{
+public:
+    /// Take ownership of and commit an uncommitted datatype
+    explicit derived_type(MPI_Datatype uncommitted_type) : datatype(uncommitted_type)
+    {
+        MPI_Type_commit(&datatype);
+    }
+
+    derived_type(derived_type&& other) noexcept : datatype(other.datatype)
+    {
+        other.datatype = MPI_DATATYPE_NULL;
+    }
+
+    derived_type& operator=(derived_type&& other) noexcept
+    {
+        std::swap(datatype, other.datatype);
+        return *this;
+    }
+
+    derived_type(derived_type const&) = delete;
+    derived_type& operator=(derived_type const&) = delete;
+
+    ~derived_type()
+    {
+        if (datatype != MPI_DATATYPE_NULL) MPI_Type_free(&datatype);
+    }
+
+    /// \return The MPI datatype handle
+    MPI_Datatype value_type() const { return datatype; }
+
+    /// \return The number of bytes of data in the type, excluding any padding
+    int size() const
+    {
+        int type_size;
+        MPI_Type_size(datatype, &type_size);
+        return type_size;
+    }
+
+private:
+    MPI_Datatype datatype;
 };
 
+/// Create a datatype describing a block of a multidimensional array, for
+/// example the part of a global grid owned by this process.
+/// \tparam T Array value type
+/// \param global_sizes Number of entries in each dimension of the full array
+/// \param local_sizes Number of entries in each dimension of the block
+/// \param starts Index of the first entry of the block in each dimension
+/// \param order Storage order of the array
+template <typename T>
+inline derived_type make_subarray(std::vector<int> const& global_sizes,
+                                  std::vector<int> const& local_sizes,
+                                  std::vector<int> const& starts,
+                                  array_order const order = array_order::row_major)
+{
+    MPI_Datatype subarray;
+
+    MPI_Type_create_subarray(global_sizes.size(),
+                             const_cast<int*>(global_sizes.data()),
+                             const_cast<int*>(local_sizes.data()),
+                             const_cast<int*>(starts.data()),
+                             static_cast<int>(order),
+                             data_type<T>::value_type(),
+                             &subarray);
+
+    return derived_type(subarray);
+}
+
+namespace detail
+{
+/// \return The MPI address of \p location
+inline MPI_Aint address(void const* location)
+{
+    MPI_Aint location_address;
+    MPI_Get_address(location, &location_address);
+    return location_address;
+}
+}
+
+/// Create a datatype for a structure from pointers to its members, e.g.
+/// \code
+/// auto const particle_type = mpi::make_struct(&particle::id, &particle::mass);
+/// \endcode
+/// The extent is resized to sizeof(Struct_Tp) so vectors of the structure
+/// can be communicated with a count equal to the number of elements.
+/// \tparam Struct_Tp Default constructible structure type
+/// \tparam Member_Tps Member types, each with a data_type specialisation
+template <typename Struct_Tp, typename... Member_Tps>
+inline derived_type make_struct(Member_Tps Struct_Tp::*... members)
+{
+    constexpr int count = sizeof...(Member_Tps);
+
+    Struct_Tp const sample{};
+
+    MPI_Aint const base_address = detail::address(&sample);
+
+    std::vector<int> block_lengths(count, 1);
+    std::vector<MPI_Aint> displacements{{detail::address(&(sample.*members)) - base_address...}};
+    std::vector<MPI_Datatype> types{{data_type<Member_Tps>::value_type()...}};
+
+    MPI_Datatype structure, resized;
+
+    MPI_Type_create_struct(count,
+                           block_lengths.data(),
+                           displacements.data(),
+                           types.data(),
+                           &structure);
+    MPI_Type_create_resized(structure, 0, sizeof(Struct_Tp), &resized);
+    MPI_Type_free(&structure);
+
+    return derived_type(resized);
+}
+
 /*----------------------------------------------------------------------------*
  *                              Synchronous types                             *
  *----------------------------------------------------------------------------*/
@@ -157,6 +457,26 @@ struct async
 {
 };
 
+/// synchronous is a send mode tag.  The send completes only once the matching
+/// receive has started (\p MPI_Ssend), so no system buffering is used.
+struct synchronous
+{
+};
+
+/// ready is a send mode tag for when the matching receive is known to be
+/// posted already (\p MPI_Rsend).  This skips the rendezvous handshake and
+/// gives the lowest latency, but the program is erroneous if the receive has
+/// not been posted.
+struct ready
+{
+};
+
+/// buffered is a send mode tag that copies the message into an attached
+/// buffer and returns immediately (\p MPI_Bsend) \sa buffer_pool
+struct buffered
+{
+};
+
 /*----------------------------------------------------------------------------*
  *                               SEND RECEIVE                                 *
  *----------------------------------------------------------------------------*/
@@ -176,7 +496,7 @@ inline auto send(blocking,
                  int const destination_process,
                  int const message_tag = 0,
                  communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<T>::value>
+    -> std::enable_if_t<detail::has_data_type<T>::value>
 {
     MPI_Send(&send_value,
              1,
@@ -200,7 +520,7 @@ inline auto send(blocking,
                  int const destination_process,
                  int const message_tag = 0,
                  communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<typename T::value_type>::value>
+    -> std::enable_if_t<detail::is_container<T>::value>
 {
     MPI_Send(const_cast<typename T::value_type*>(send_vector.data()),
              send_vector.size(),
@@ -221,7 +541,7 @@ template <typename T>
 inline auto receive(int const source_process,
                     int const message_tag = 0,
                     communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<T>::value, T>
+    -> std::enable_if_t<detail::has_data_type<T>::value, T>
 {
     T recieve_value;
 
@@ -239,7 +559,8 @@ inline auto receive(int const source_process,
 /// Perform an MPI receive operation on types which are able to have primitive
 /// operations defined on it.  This function call is only used for vector types
 /// and automatically probes the size, resizes the return vector and returns the
-/// data.
+/// data.  The probe removes the message from the queue (\p MPI_Mprobe) so
+/// concurrent receives from other threads cannot take it first.
 /// \tparam T Data type to receive
 /// \param source_process Processor to receive from
 /// \param message_tag Matching tag to the message
@@ -249,15 +570,17 @@ template <typename T>
 inline auto receive(int const source_process,
                     int const message_tag = 0,
                     communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<typename T::value_type>::value, T>
+    -> std::enable_if_t<detail::is_container<T>::value, T>
 {
     ::mpi::status probe_status;
+    MPI_Message message;
 
     // Probe for an incoming message from the sending process
-    MPI_Probe(source_process,
-              message_tag,
-              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
-              &probe_status);
+    MPI_Mprobe(source_process,
+               message_tag,
+               comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+               &message,
+               &probe_status);
 
     int buffer_size;
 
@@ -265,13 +588,11 @@ inline auto receive(int const source_process,
 
     T receive_buffer(buffer_size);
 
-    MPI_Recv(receive_buffer.data(),
-             receive_buffer.size(),
-             data_type<typename T::value_type>::value_type(),
-             source_process,
-             message_tag,
-             comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
-             MPI_STATUS_IGNORE);
+    MPI_Mrecv(receive_buffer.data(),
+              receive_buffer.size(),
+              data_type<typename T::value_type>::value_type(),
+              &message,
+              MPI_STATUS_IGNORE);
 
     return receive_buffer;
 }
@@ -287,15 +608,15 @@ inline auto receive(int const source_process,
 /// \param send_value Value to send
 /// \param destination_process
 /// \param message_tag
-/// \param comm Communicator
+/// \param comm MPI communicator handle, such as a duplicate of MPI_COMM_WORLD
 /// \return An MPI request object \sa request
 template <typename T>
 inline auto send(async,
                  T const& send_value,
                  int const destination_process,
-                 int const message_tag = 0,
-                 communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<T>::value, request>
+                 int const message_tag,
+                 MPI_Comm const comm)
+    -> std::enable_if_t<detail::has_data_type<T>::value, request>
 {
     request async_send_request;
 
@@ -304,12 +625,28 @@ inline auto send(async,
               data_type<T>::value_type(),
               destination_process,
               message_tag,
-              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+              comm,
               &async_send_request);
 
     return async_send_request;
 }
 
+/// \sa send(async, T const&, int, int, MPI_Comm)
+template <typename T>
+inline auto send(async,
+                 T const& send_value,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::has_data_type<T>::value, request>
+{
+    return send(async{},
+                send_value,
+                destination_process,
+                message_tag,
+                comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
 /// Perform an asynchronous MPI send operation.  This function call is only for
 /// a contiguous vector of built-in types.
 /// \tparam Value type
@@ -317,15 +654,15 @@ inline auto send(async,
 /// \param send_value Vector to send
 /// \param destination_process
 /// \param message_tag
-/// \param comm Communicator
+/// \param comm MPI communicator handle, such as a duplicate of MPI_COMM_WORLD
 /// \return An MPI request object \sa request
 template <typename T>
 inline auto send(async,
                  T const& send_data,
                  int const destination_process,
-                 int const message_tag = 0,
-                 communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<typename T::value_type>::value, request>
+                 int const message_tag,
+                 MPI_Comm const comm)
+    -> std::enable_if_t<detail::is_container<T>::value, request>
 {
     request async_send_request;
 
@@ -334,12 +671,119 @@ inline auto send(async,
               data_type<typename T::value_type>::value_type(),
               destination_process,
               message_tag,
-              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+              comm,
               &async_send_request);
 
     return async_send_request;
 }
 
+/// \sa send(async, T const&, int, int, MPI_Comm)
+template <typename T>
+inline auto send(async,
+                 T const& send_data,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_container<T>::value, request>
+{
+    return send(async{},
+                send_data,
+                destination_process,
+                message_tag,
+                comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
+/// Start an asynchronous MPI receive into a built-in value.  The value must
+/// not be accessed until the request has completed.
+/// \param async
+/// \param receive_value Destination of the message
+/// \param source_process Processor to receive from
+/// \param message_tag Matching tag to the message
+/// \param comm MPI communicator handle, such as a duplicate of MPI_COMM_WORLD
+/// \return An MPI request object \sa request
+template <typename T>
+inline auto receive(async,
+                    T& receive_value,
+                    int const source_process,
+                    int const message_tag,
+                    MPI_Comm const comm)
+    -> std::enable_if_t<detail::has_data_type<T>::value, request>
+{
+    request async_receive_request;
+
+    MPI_Irecv(&receive_value,
+              1,
+              data_type<T>::value_type(),
+              source_process,
+              message_tag,
+              comm,
+              &async_receive_request);
+
+    return async_receive_request;
+}
+
+/// \sa receive(async, T&, int, int, MPI_Comm)
+template <typename T>
+inline auto receive(async,
+                    T& receive_value,
+                    int const source_process,
+                    int const message_tag = 0,
+                    communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::has_data_type<T>::value, request>
+{
+    return receive(async{},
+                   receive_value,
+                   source_process,
+                   message_tag,
+                   comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
+/// Start an asynchronous MPI receive into a contiguous vector of built-in
+/// types.  The vector must already have the size of the message and must not
+/// be accessed until the request has completed.
+/// \param async
+/// \param receive_data Destination of the message
+/// \param source_process Processor to receive from
+/// \param message_tag Matching tag to the message
+/// \param comm MPI communicator handle, such as a duplicate of MPI_COMM_WORLD
+/// \return An MPI request object \sa request
+template <typename T>
+inline auto receive(async,
+                    T& receive_data,
+                    int const source_process,
+                    int const message_tag,
+                    MPI_Comm const comm)
+    -> std::enable_if_t<detail::is_container<T>::value, request>
+{
+    request async_receive_request;
+
+    MPI_Irecv(receive_data.data(),
+              receive_data.size(),
+              data_type<typename T::value_type>::value_type(),
+              source_process,
+              message_tag,
+              comm,
+              &async_receive_request);
+
+    return async_receive_request;
+}
+
+/// \sa receive(async, T&, int, int, MPI_Comm)
+template <typename T>
+inline auto receive(async,
+                    T& receive_data,
+                    int const source_process,
+                    int const message_tag = 0,
+                    communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_container<T>::value, request>
+{
+    return receive(async{},
+                   receive_data,
+                   source_process,
+                   message_tag,
+                   comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
 /// Wait until the asynchronous send operation in request is finished.
 /// \sa request
 /// \sa status
@@ -370,64 +814,367 @@ inline auto wait_all(std::vector<request>& async_requests) -> std::vector<status
     return statuses;
 }
 
-/*----------------------------------------------------------------------------*
- *                           BROADCAST OPERATIONS                             *
- *----------------------------------------------------------------------------*/
-
-/// broadcast sends the local data from the host_processor across the
-/// communicator which is defaulted to 0. The result can be read out from the
-/// \p host_processor and the slave processors are none the wiser.
-/// \tparam T Data type
-/// \param local_data Value to send if we are the host_processor
-/// \param host_processor Process responsible for sending out the data
-/// \param comm MPI communicator
-/// \return Broadcasted data
-template <typename T>
-inline auto broadcast(T local_data,
-                      int const host_processor = 0,
-                      communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<T>::value, T>
+/// Wait until any one of the asynchronous operations in requests is finished.
+/// The completed request is set to \p MPI_REQUEST_NULL, so calling this again
+/// returns the operations in the order they complete.
+/// \sa wait_all()
+/// \param async_requests A std::vector of request objects
+/// \return The index of the completed request, or -1 if no request is active
+inline int wait_any(std::vector<request>& async_requests)
 {
-    MPI_Bcast(&local_data,
-              1,
-              data_type<T>::value_type(),
-              host_processor,
-              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+    int index;
 
-    return local_data;
-}
-
-/// broadcast sends the local data from the host_processor across the
-/// communicator which is defaulted to 0.  The result can be read out from the
-/// host_processor and the slave processors are none the wiser.
-/// \tparam T Value type
-/// \param local_data Value to send if we are the host_processor
-/// \param host_processor Process responsible for sending out the data
-/// \param comm MPI communicator
-/// \return The broadcast data
-template <typename T>
-inline auto broadcast(T local_data,
-                      int const host_processor = 0,
-                      communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<typename T::value_type>::value, T>
-{
-    MPI_Bcast(local_data.data(),
-              local_data.size(),
-              data_type<typename T::value_type>::value_type(),
-              host_processor,
-              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+    MPI_Waitany(async_requests.size(), async_requests.data(), &index, MPI_STATUS_IGNORE);
 
-    return local_data;
+    return index == MPI_UNDEFINED ? -1 : index;
 }
 
 /*----------------------------------------------------------------------------*
- *                           REDUCTION OPERATIONS                             *
+ *                                SEND MODES                                  *
  *----------------------------------------------------------------------------*/
 
-/// reduce computes across the Operation_tp and stores the result in
-/// \param host_processor (default 0)
-/// The result can be read out only from \p host_processor
-/// \param local_data Data to be operated on
+class buffer_pool;
+
+namespace detail
+{
+/// \return The buffer pool attached to the process, or nullptr
+inline buffer_pool*& attached_pool()
+{
+    static buffer_pool* pool = nullptr;
+    return pool;
+}
+}
+
+/// buffer_pool attaches a buffer for buffered sends (\p MPI_Buffer_attach)
+/// for its lifetime.  Each buffered send reserves the space of its message
+/// and, once the buffer is exhausted, the pool waits for the earlier buffered
+/// messages to be delivered (\p MPI_Buffer_detach), grows if the message is
+/// larger than the buffer and attaches it again.  Reclaiming the buffer
+/// therefore only completes once the receives of the earlier buffered
+/// messages have been posted.  Only one pool can exist in a process.
+class buffer_pool
+{
+public:
+    /// \param initial_bytes Initial size of the attached buffer
+    explicit buffer_pool(std::size_t const initial_bytes = 1 << 20) : storage(initial_bytes)
+    {
+        if (detail::attached_pool() != nullptr)
+        {
+            throw std::runtime_error("mpi::buffer_pool: a buffer is already attached");
+        }
+        attach();
+        detail::attached_pool() = this;
+    }
+
+    buffer_pool(buffer_pool const&) = delete;
+    buffer_pool& operator=(buffer_pool const&) = delete;
+
+    /// Waits for the buffered messages to be delivered
+    ~buffer_pool()
+    {
+        detach();
+        detail::attached_pool() = nullptr;
+    }
+
+    /// \return The size of the attached buffer in bytes
+    std::size_t capacity() const { return storage.size(); }
+
+    /// Make room for a buffered message of \p packed_bytes, growing the buffer
+    /// if needed
+    void reserve(std::size_t const packed_bytes)
+    {
+        auto const required = packed_bytes + MPI_BSEND_OVERHEAD;
+
+        if (used + required <= storage.size())
+        {
+            used += required;
+            return;
+        }
+
+        detach();
+        if (required > storage.size()) storage.resize(std::max(2 * storage.size(), required));
+        attach();
+
+        used = required;
+    }
+
+private:
+    void attach() { MPI_Buffer_attach(storage.data(), storage.size()); }
+
+    void detach()
+    {
+        void* detached;
+        int detached_size;
+        MPI_Buffer_detach(&detached, &detached_size);
+    }
+
+private:
+    std::vector<char> storage;
+
+    /// Bytes reserved since the buffer was last attached
+    std::size_t used = 0;
+};
+
+namespace detail
+{
+template <typename Mode_Tp>
+struct is_send_mode
+    : std::integral_constant<bool,
+                             std::is_same<Mode_Tp, synchronous>::value
+                                 || std::is_same<Mode_Tp, ready>::value
+                                 || std::is_same<Mode_Tp, buffered>::value>
+{
+};
+
+/// MPI calls of each send mode, blocking and nonblocking
+template <typename Mode_Tp>
+struct send_mode;
+
+template <>
+struct send_mode<synchronous>
+{
+    static void send(void* data,
+                     int count,
+                     MPI_Datatype type,
+                     int destination,
+                     int tag,
+                     MPI_Comm comm)
+    {
+        MPI_Ssend(data, count, type, destination, tag, comm);
+    }
+
+    static request start(void* data,
+                         int count,
+                         MPI_Datatype type,
+                         int destination,
+                         int tag,
+                         MPI_Comm comm)
+    {
+        request started;
+        MPI_Issend(data, count, type, destination, tag, comm, &started);
+        return started;
+    }
+};
+
+template <>
+struct send_mode<ready>
+{
+    static void send(void* data,
+                     int count,
+                     MPI_Datatype type,
+                     int destination,
+                     int tag,
+                     MPI_Comm comm)
+    {
+        MPI_Rsend(data, count, type, destination, tag, comm);
+    }
+
+    static request start(void* data,
+                         int count,
+                         MPI_Datatype type,
+                         int destination,
+                         int tag,
+                         MPI_Comm comm)
+    {
+        request started;
+        MPI_Irsend(data, count, type, destination, tag, comm, &started);
+        return started;
+    }
+};
+
+template <>
+struct send_mode<buffered>
+{
+    static void send(void* data,
+                     int count,
+                     MPI_Datatype type,
+                     int destination,
+                     int tag,
+                     MPI_Comm comm)
+    {
+        reserve(count, type, comm);
+        MPI_Bsend(data, count, type, destination, tag, comm);
+    }
+
+    static request start(void* data,
+                         int count,
+                         MPI_Datatype type,
+                         int destination,
+                         int tag,
+                         MPI_Comm comm)
+    {
+        reserve(count, type, comm);
+
+        request started;
+        MPI_Ibsend(data, count, type, destination, tag, comm, &started);
+        return started;
+    }
+
+    /// Make room in the buffer pool, if there is one, for the packed message
+    static void reserve(int count, MPI_Datatype type, MPI_Comm comm)
+    {
+        if (attached_pool() == nullptr) return;
+
+        int packed_bytes;
+        MPI_Pack_size(count, type, comm, &packed_bytes);
+
+        attached_pool()->reserve(packed_bytes);
+    }
+};
+}
+
+/// Send a built-in value with the given send mode
+/// \tparam Mode_Tp synchronous, ready or buffered
+/// \param send_value Value to send
+/// \param destination_process Where to send the data
+/// \param message_tag Add a tag to the message
+/// \param comm Communicator type
+template <typename Mode_Tp, typename T>
+inline auto send(Mode_Tp,
+                 T const& send_value,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_send_mode<Mode_Tp>::value && detail::has_data_type<T>::value>
+{
+    detail::send_mode<Mode_Tp>::send(const_cast<T*>(&send_value),
+                                     1,
+                                     data_type<T>::value_type(),
+                                     destination_process,
+                                     message_tag,
+                                     comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
+/// Send a contiguous vector of built-in types with the given send mode
+/// \tparam Mode_Tp synchronous, ready or buffered
+/// \param send_data Vector to send
+/// \param destination_process Where to send the data
+/// \param message_tag Add a tag to the message
+/// \param comm Communicator type
+template <typename Mode_Tp, typename T>
+inline auto send(Mode_Tp,
+                 T const& send_data,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_send_mode<Mode_Tp>::value && detail::is_container<T>::value>
+{
+    detail::send_mode<Mode_Tp>::send(const_cast<typename T::value_type*>(send_data.data()),
+                                     send_data.size(),
+                                     data_type<typename T::value_type>::value_type(),
+                                     destination_process,
+                                     message_tag,
+                                     comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
+/// Start sending a built-in value with the given send mode.  A buffered send
+/// has copied the value when this returns, the other modes must not modify it
+/// until the request has completed.
+/// \tparam Mode_Tp synchronous, ready or buffered
+/// \param send_value Value to send
+/// \param destination_process Where to send the data
+/// \param message_tag Add a tag to the message
+/// \param comm Communicator type
+/// \return An MPI request object \sa request
+template <typename Mode_Tp, typename T>
+inline auto send(async,
+                 Mode_Tp,
+                 T const& send_value,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_send_mode<Mode_Tp>::value && detail::has_data_type<T>::value,
+                        request>
+{
+    return detail::send_mode<Mode_Tp>::start(const_cast<T*>(&send_value),
+                                             1,
+                                             data_type<T>::value_type(),
+                                             destination_process,
+                                             message_tag,
+                                             comm == communicator::world ? MPI_COMM_WORLD
+                                                                         : MPI_COMM_SELF);
+}
+
+/// Start sending a contiguous vector of built-in types with the given send
+/// mode \sa send(async, Mode_Tp, T const&, int, int, communicator)
+/// \return An MPI request object \sa request
+template <typename Mode_Tp, typename T>
+inline auto send(async,
+                 Mode_Tp,
+                 T const& send_data,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_send_mode<Mode_Tp>::value && detail::is_container<T>::value,
+                        request>
+{
+    return detail::send_mode<Mode_Tp>::start(const_cast<typename T::value_type*>(send_data.data()),
+                                             send_data.size(),
+                                             data_type<typename T::value_type>::value_type(),
+                                             destination_process,
+                                             message_tag,
+                                             comm == communicator::world ? MPI_COMM_WORLD
+                                                                         : MPI_COMM_SELF);
+}
+
+/*----------------------------------------------------------------------------*
+ *                           BROADCAST OPERATIONS                             *
+ *----------------------------------------------------------------------------*/
+
+/// broadcast sends the local data from the host_processor across the
+/// communicator which is defaulted to 0. The result can be read out from the
+/// \p host_processor and the slave processors are none the wiser.
+/// \tparam T Data type
+/// \param local_data Value to send if we are the host_processor
+/// \param host_processor Process responsible for sending out the data
+/// \param comm MPI communicator
+/// \return Broadcasted data
+template <typename T>
+inline auto broadcast(T local_data,
+                      int const host_processor = 0,
+                      communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::has_data_type<T>::value, T>
+{
+    MPI_Bcast(&local_data,
+              1,
+              data_type<T>::value_type(),
+              host_processor,
+              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    return local_data;
+}
+
+/// broadcast sends the local data from the host_processor across the
+/// communicator which is defaulted to 0.  The result can be read out from the
+/// host_processor and the slave processors are none the wiser.
+/// \tparam T Value type
+/// \param local_data Value to send if we are the host_processor
+/// \param host_processor Process responsible for sending out the data
+/// \param comm MPI communicator
+/// \return The broadcast data
+template <typename T>
+inline auto broadcast(T local_data,
+                      int const host_processor = 0,
+                      communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_container<T>::value, T>
+{
+    MPI_Bcast(local_data.data(),
+              local_data.size(),
+              data_type<typename T::value_type>::value_type(),
+              host_processor,
+              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    return local_data;
+}
+
+/*----------------------------------------------------------------------------*
+ *                           REDUCTION OPERATIONS                             *
+ *----------------------------------------------------------------------------*/
+
+/// reduce computes across the Operation_tp and stores the result in
+/// \param host_processor (default 0)
+/// The result can be read out only from \p host_processor
+/// \param local_data Data to be operated on
 /// \param operation_type Reduction operation
 /// \param host_processor Host processor index
 /// \param comm MPI Communicator
@@ -524,7 +1271,7 @@ inline auto all_reduce(T const& local_reduction_variable,
 /// communicator to store the results from the other processors.
 template <typename T>
 inline auto all_to_all(T local_data, communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<T>::value, T>
+    -> std::enable_if_t<detail::has_data_type<T>::value, T>
 {
     T collected_data(mpi::size(comm));
 
@@ -539,20 +1286,33 @@ inline auto all_to_all(T local_data, communicator const comm = communicator::wor
     return collected_data;
 }
 
-/// Perform an MPI all to all operation on a vector of primitive types.
-/// This function allocates a vector of the same type and size of the of the
-/// communicator to store the results from the other processors.
+/// Perform an MPI all to all operation on a vector of primitive types.  The
+/// local vector is split into size(comm) equal blocks and block i is sent to
+/// process i.  Throws std::runtime_error if the size of the vector is not a
+/// multiple of the number of processes.
+/// \return The blocks received from each process, ordered by rank
 template <typename T>
 inline auto all_to_all(T const& local_data, communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<typename T::value_type>::value, T>
+    -> std::enable_if_t<detail::is_container<T>::value, T>
 {
-    T collected_data(local_data.size() * mpi::size(comm));
+    auto const processes = mpi::size(comm);
+
+    if (local_data.size() % processes != 0)
+    {
+        throw std::runtime_error("mpi::all_to_all: the size must be a multiple of the number of "
+                                 "processes");
+    }
+
+    // Each process receives one block of the local vector
+    auto const block_size = local_data.size() / processes;
+
+    T collected_data(local_data.size());
 
     MPI_Alltoall(const_cast<typename T::value_type*>(local_data.data()),
-                 local_data.size(),
+                 block_size,
                  data_type<typename T::value_type>::value_type(),
                  collected_data.data(),
-                 collected_data.size(),
+                 block_size,
                  data_type<typename T::value_type>::value_type(),
                  comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
 
@@ -566,7 +1326,7 @@ template <typename VectorType>
 inline auto gather(VectorType const& local_data,
                    int const root_process,
                    communicator const comm = communicator::world)
-    -> std::enable_if_t<std::is_arithmetic<typename VectorType::value_type>::value, VectorType>
+    -> std::enable_if_t<detail::is_container<VectorType>::value, VectorType>
 {
     VectorType collected_data(root_process == ::mpi::rank() ? local_data.size() * mpi::size(comm)
                                                             : 1);
@@ -582,17 +1342,512 @@ inline auto gather(VectorType const& local_data,
     return collected_data;
 }
 
-/// Initialise a threaded MPI environment
-inline void initialise(int argc, char** argv, thread const thread_required)
+/// Perform an MPI all gather operation on a primitive type
+/// \return A vector holding the value from each process ordered by rank
+template <typename T>
+inline auto all_gather(T local_value, communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::has_data_type<T>::value, std::vector<T>>
+{
+    std::vector<T> collected_data(mpi::size(comm));
+
+    MPI_Allgather(&local_value,
+                  1,
+                  data_type<T>::value_type(),
+                  collected_data.data(),
+                  1,
+                  data_type<T>::value_type(),
+                  comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    return collected_data;
+}
+
+namespace detail
+{
+/// All gather of a vector of \p datatype where the number of entries may be
+/// different on each process
+/// \return The number of entries received from each process
+template <typename VectorType>
+inline std::vector<int> all_gather(VectorType const& local_data,
+                                   VectorType& collected_data,
+                                   MPI_Datatype const datatype,
+                                   communicator const comm)
+{
+    auto const counts = mpi::all_gather(static_cast<int>(local_data.size()), comm);
+
+    std::vector<int> displacements(counts.size(), 0);
+    std::partial_sum(begin(counts), std::prev(end(counts)), std::next(begin(displacements)));
+
+    collected_data.resize(displacements.back() + counts.back());
+
+    MPI_Allgatherv(const_cast<typename VectorType::value_type*>(local_data.data()),
+                   local_data.size(),
+                   datatype,
+                   collected_data.data(),
+                   const_cast<int*>(counts.data()),
+                   displacements.data(),
+                   datatype,
+                   comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    return counts;
+}
+
+/// All to all of a vector of \p datatype where \p send_counts[i] consecutive
+/// entries of \p local_data are sent to process i
+/// \return The number of entries received from each process
+template <typename VectorType>
+inline std::vector<int> all_to_allv(VectorType const& local_data,
+                                    std::vector<int> const& send_counts,
+                                    VectorType& collected_data,
+                                    MPI_Datatype const datatype,
+                                    communicator const comm)
+{
+    std::vector<int> receive_counts(send_counts.size());
+
+    MPI_Alltoall(const_cast<int*>(send_counts.data()),
+                 1,
+                 MPI_INT,
+                 receive_counts.data(),
+                 1,
+                 MPI_INT,
+                 comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    std::vector<int> send_displacements(send_counts.size(), 0);
+    std::vector<int> receive_displacements(receive_counts.size(), 0);
+
+    std::partial_sum(begin(send_counts),
+                     std::prev(end(send_counts)),
+                     std::next(begin(send_displacements)));
+    std::partial_sum(begin(receive_counts),
+                     std::prev(end(receive_counts)),
+                     std::next(begin(receive_displacements)));
+
+    collected_data.resize(receive_displacements.back() + receive_counts.back());
+
+    MPI_Alltoallv(const_cast<typename VectorType::value_type*>(local_data.data()),
+                  const_cast<int*>(send_counts.data()),
+                  send_displacements.data(),
+                  datatype,
+                  collected_data.data(),
+                  receive_counts.data(),
+                  receive_displacements.data(),
+                  datatype,
+                  comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    return receive_counts;
+}
+}
+
+/// Perform an MPI all gather operation on a vector of primitive types.  The
+/// number of entries may be different on each process.
+/// \return The concatenation of the vectors from each process ordered by rank
+template <typename VectorType>
+inline auto all_gather(VectorType const& local_data, communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_container<VectorType>::value, VectorType>
+{
+    VectorType collected_data;
+
+    detail::all_gather(local_data,
+                       collected_data,
+                       data_type<typename VectorType::value_type>::value_type(),
+                       comm);
+
+    return collected_data;
+}
+
+/// Perform an MPI all to all operation with a variable number of entries.
+/// The first \p send_counts[0] entries of \p local_data are sent to process 0,
+/// the next \p send_counts[1] entries to process 1 and so on.
+/// \param local_data Data to send ordered by destination process
+/// \param send_counts Number of entries to send to each process
+/// \param comm MPI communicator
+/// \return The entries received from each process ordered by rank
+template <typename VectorType>
+inline auto all_to_allv(VectorType const& local_data,
+                        std::vector<int> const& send_counts,
+                        communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::is_container<VectorType>::value, VectorType>
+{
+    VectorType collected_data;
+
+    detail::all_to_allv(local_data,
+                        send_counts,
+                        collected_data,
+                        data_type<typename VectorType::value_type>::value_type(),
+                        comm);
+
+    return collected_data;
+}
+
+/*----------------------------------------------------------------------------*
+ *                      REDUCED PRECISION WIRE FORMAT                         *
+ *----------------------------------------------------------------------------*/
+
+/// \class half
+/// \brief IEEE 754 binary16 storage (5 bit exponent, 10 bit mantissa)
+struct half
+{
+    std::uint16_t bits;
+};
+
+/// \class bfloat16
+/// \brief Truncated binary32 storage (8 bit exponent, 7 bit mantissa).  This
+/// keeps the range of \p float and is the better choice for sums of values
+/// with a large dynamic range
+struct bfloat16
+{
+    std::uint16_t bits;
+};
+
+/// reduced_precision is a type tag that narrows floating point data to the
+/// 16 bit \p Compact_Tp (\sa half or \sa bfloat16) before it is put on the wire
+/// and widens it again on receipt.  This halves (float) or quarters (double)
+/// the message size at the cost of roughly three (half) or two (bfloat16)
+/// significant decimal digits.
+template <typename Compact_Tp>
+struct reduced_precision
+{
+};
+
+namespace detail
+{
+inline std::uint32_t float_as_bits(float const value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bits_as_float(std::uint32_t const bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/// Scalar conversions between float and the compact storage types.  These are
+/// written without branches so the loops in narrow() and widen() vectorise.
+template <typename Compact_Tp>
+struct compact_traits;
+
+template <>
+struct compact_traits<bfloat16>
+{
+    /// Round to nearest even, keeping NaN quiet
+    static std::uint16_t narrow(float const value)
+    {
+        std::uint32_t const bits = float_as_bits(value);
+        std::uint32_t const rounded = (bits + 0x7FFFu + ((bits >> 16) & 1u)) >> 16;
+        bool const is_nan = (bits & 0x7FFFFFFFu) > 0x7F800000u;
+        return static_cast<std::uint16_t>(is_nan ? (bits >> 16) | 0x40u : rounded);
+    }
+
+    static float widen(std::uint16_t const bits)
+    {
+        return bits_as_float(static_cast<std::uint32_t>(bits) << 16);
+    }
+};
+
+template <>
+struct compact_traits<half>
+{
+    /// Round to nearest even with overflow to infinity and gradual underflow
+    static std::uint16_t narrow(float const value)
+    {
+        std::uint32_t const infinity = 255u << 23;
+        std::uint32_t const half_max = (127u + 16u) << 23;
+        std::uint32_t const denormal_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+        std::uint32_t const bits = float_as_bits(value);
+        std::uint32_t const sign = bits & 0x80000000u;
+        std::uint32_t const magnitude = bits ^ sign;
+
+        // Infinity or NaN (NaN becomes a quiet NaN)
+        std::uint32_t const special = magnitude > infinity ? 0x7E00u : 0x7C00u;
+
+        // Subnormal or zero result, let the floating point unit do the rounding
+        std::uint32_t const subnormal = float_as_bits(bits_as_float(magnitude)
+                                                      + bits_as_float(denormal_magic))
+                                        - denormal_magic;
+
+        // Normal result, rebias the exponent and round the mantissa
+        std::uint32_t const mantissa_odd = (magnitude >> 13) & 1u;
+        std::uint32_t const normal = (magnitude + ((15u - 127u) << 23) + 0xFFFu + mantissa_odd)
+                                     >> 13;
+
+        std::uint32_t const result = magnitude >= half_max
+                                         ? special
+                                         : magnitude < (113u << 23) ? subnormal : normal;
+
+        return static_cast<std::uint16_t>(result | (sign >> 16));
+    }
+
+    static float widen(std::uint16_t const bits)
+    {
+        std::uint32_t const shifted_exponent = 0x7C00u << 13;
+        std::uint32_t const magic = 113u << 23;
+
+        std::uint32_t const exponent_mantissa = (bits & 0x7FFFu) << 13;
+        std::uint32_t const exponent = exponent_mantissa & shifted_exponent;
+        std::uint32_t const rebiased = exponent_mantissa + ((127u - 15u) << 23);
+
+        std::uint32_t const special = rebiased + ((128u - 16u) << 23);
+        std::uint32_t const subnormal = float_as_bits(bits_as_float(rebiased + (1u << 23))
+                                                      - bits_as_float(magic));
+
+        std::uint32_t const result = exponent == shifted_exponent
+                                         ? special
+                                         : exponent == 0 ? subnormal : rebiased;
+
+        return bits_as_float(result | (static_cast<std::uint32_t>(bits & 0x8000u) << 16));
+    }
+};
+
+/// Convert \p count floating point values into compact storage.  Values are
+/// converted to float first, so a double is rounded twice, which can differ
+/// from rounding it straight to \p Compact_Tp by one unit in the last place
+/// when the value lies close to halfway between two compact values.
+template <typename Compact_Tp, typename T>
+inline void narrow(T const* first, std::size_t const count, std::uint16_t* compact)
+{
+    std::size_t index = 0;
+#if defined(__F16C__)
+    if (std::is_same<Compact_Tp, half>::value && std::is_same<T, float>::value)
+    {
+        for (; index + 8 <= count; index += 8)
+        {
+            __m256 const values = _mm256_loadu_ps(reinterpret_cast<float const*>(first + index));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(compact + index),
+                             _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+        }
+    }
+#endif
+    for (; index < count; ++index)
+    {
+        compact[index] = compact_traits<Compact_Tp>::narrow(static_cast<float>(first[index]));
+    }
+}
+
+/// Convert \p count compact values back into floating point values
+template <typename Compact_Tp, typename T>
+inline void widen(std::uint16_t const* compact, std::size_t const count, T* first)
+{
+    std::size_t index = 0;
+#if defined(__F16C__)
+    if (std::is_same<Compact_Tp, half>::value && std::is_same<T, float>::value)
+    {
+        for (; index + 8 <= count; index += 8)
+        {
+            __m128i const values = _mm_loadu_si128(
+                reinterpret_cast<__m128i const*>(compact + index));
+            _mm256_storeu_ps(reinterpret_cast<float*>(first + index), _mm256_cvtph_ps(values));
+        }
+    }
+#endif
+    for (; index < count; ++index)
+    {
+        first[index] = static_cast<T>(compact_traits<Compact_Tp>::widen(compact[index]));
+    }
+}
+
+/// Map a reduction tag onto the binary operation it performs
+template <typename Operation_Tp>
+struct binary_operation;
+
+template <>
+struct binary_operation<sum>
+{
+    static float apply(float const lhs, float const rhs) { return lhs + rhs; }
+};
+
+template <>
+struct binary_operation<prod>
+{
+    static float apply(float const lhs, float const rhs) { return lhs * rhs; }
+};
+
+template <>
+struct binary_operation<min>
+{
+    static float apply(float const lhs, float const rhs) { return lhs < rhs ? lhs : rhs; }
+};
+
+template <>
+struct binary_operation<max>
+{
+    static float apply(float const lhs, float const rhs) { return lhs > rhs ? lhs : rhs; }
+};
+
+/// User defined reduction that combines two compact buffers by widening each
+/// pair to float, applying the operation and rounding the result once
+template <typename Compact_Tp, typename Operation_Tp>
+void compact_reduction(void* input, void* input_output, int* length, MPI_Datatype*)
+{
+    auto const* lhs = static_cast<std::uint16_t const*>(input);
+    auto* rhs = static_cast<std::uint16_t*>(input_output);
+
+    for (int index = 0; index < *length; ++index)
+    {
+        rhs[index] = compact_traits<Compact_Tp>::narrow(
+            binary_operation<Operation_Tp>::apply(compact_traits<Compact_Tp>::widen(lhs[index]),
+                                                  compact_traits<Compact_Tp>::widen(rhs[index])));
+    }
+}
+
+/// \return The (lazily created) MPI operation for the compact reduction.  The
+/// handle lives until \p MPI_Finalize releases it
+template <typename Compact_Tp, typename Operation_Tp>
+inline MPI_Op compact_operation()
+{
+    static MPI_Op const operation = [] {
+        MPI_Op created_operation;
+        MPI_Op_create(&compact_reduction<Compact_Tp, Operation_Tp>, 1, &created_operation);
+        return created_operation;
+    }();
+    return operation;
+}
+}
+
+/// Perform an MPI Allreduce operation on a vector of floating point values
+/// using a 16 bit representation on the wire.  Each partial result is combined
+/// in single precision and rounded back to \p Compact_Tp, so the result carries
+/// the precision of the compact type.  The combination is done in float
+/// whatever the input type, and double values are rounded to float before
+/// they are rounded to \p Compact_Tp.
+/// \tparam Compact_Tp Wire format \sa half \sa bfloat16
+/// \tparam Operation_Tp One of sum, prod, min or max
+/// \param local_reduction_variable Local contribution
+/// \param comm MPI communicator
+/// \return The reduced vector widened to the input type
+template <typename Compact_Tp, typename T, typename Operation_Tp>
+inline auto all_reduce(reduced_precision<Compact_Tp>,
+                       T const& local_reduction_variable,
+                       Operation_Tp&&,
+                       communicator const comm = communicator::world)
+    -> std::enable_if_t<std::is_floating_point<typename T::value_type>::value, T>
+{
+    std::vector<std::uint16_t> compact_data(local_reduction_variable.size());
+
+    detail::narrow<Compact_Tp>(local_reduction_variable.data(),
+                               local_reduction_variable.size(),
+                               compact_data.data());
+
+    MPI_Allreduce(MPI_IN_PLACE,
+                  compact_data.data(),
+                  compact_data.size(),
+                  MPI_UINT16_T,
+                  detail::compact_operation<Compact_Tp, std::decay_t<Operation_Tp>>(),
+                  comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    T reduction_variable(local_reduction_variable.size());
+
+    detail::widen<Compact_Tp>(compact_data.data(), compact_data.size(), reduction_variable.data());
+
+    return reduction_variable;
+}
+
+/// broadcast a vector of floating point values from the \p host_processor using
+/// a 16 bit representation on the wire.  The receiving processes must provide
+/// a vector of the same size as the one on the \p host_processor.  The
+/// \p host_processor also returns the rounded values so every process agrees.
+/// \tparam Compact_Tp Wire format \sa half \sa bfloat16
+/// \param local_data Values to send if we are the host_processor
+/// \param host_processor Process responsible for sending out the data
+/// \param comm MPI communicator
+/// \return The broadcast data
+template <typename Compact_Tp, typename T>
+inline auto broadcast(reduced_precision<Compact_Tp>,
+                      T local_data,
+                      int const host_processor = 0,
+                      communicator const comm = communicator::world)
+    -> std::enable_if_t<std::is_floating_point<typename T::value_type>::value, T>
+{
+    std::vector<std::uint16_t> compact_data(local_data.size());
+
+    if (host_processor == ::mpi::rank(comm))
+    {
+        detail::narrow<Compact_Tp>(local_data.data(), local_data.size(), compact_data.data());
+    }
+
+    MPI_Bcast(compact_data.data(),
+              compact_data.size(),
+              MPI_UINT16_T,
+              host_processor,
+              comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    detail::widen<Compact_Tp>(compact_data.data(), compact_data.size(), local_data.data());
+
+    return local_data;
+}
+
+/// Perform an MPI all to all operation on a vector of floating point values
+/// using a 16 bit representation on the wire.  The local vector is split into
+/// size(comm) equal blocks and block i is sent to process i.  Throws
+/// std::runtime_error if the size of the vector is not a multiple of the
+/// number of processes.
+/// \tparam Compact_Tp Wire format \sa half \sa bfloat16
+/// \return The blocks received from each process, ordered by rank
+template <typename Compact_Tp, typename T>
+inline auto all_to_all(reduced_precision<Compact_Tp>,
+                       T const& local_data,
+                       communicator const comm = communicator::world)
+    -> std::enable_if_t<std::is_floating_point<typename T::value_type>::value, T>
+{
+    auto const processes = mpi::size(comm);
+
+    if (local_data.size() % processes != 0)
+    {
+        throw std::runtime_error("mpi::all_to_all: the size must be a multiple of the number of "
+                                 "processes");
+    }
+
+    // Each process receives one block of the local vector
+    auto const block_size = local_data.size() / processes;
+
+    std::vector<std::uint16_t> compact_data(local_data.size());
+    std::vector<std::uint16_t> collected_compact(local_data.size());
+
+    detail::narrow<Compact_Tp>(local_data.data(), local_data.size(), compact_data.data());
+
+    MPI_Alltoall(compact_data.data(),
+                 block_size,
+                 MPI_UINT16_T,
+                 collected_compact.data(),
+                 block_size,
+                 MPI_UINT16_T,
+                 comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+
+    T collected_data(collected_compact.size());
+
+    detail::widen<Compact_Tp>(collected_compact.data(),
+                              collected_compact.size(),
+                              collected_data.data());
+
+    return collected_data;
+}
+
+/// Initialise a threaded MPI environment.  MPI may remove the arguments it
+/// recognises from \p argc and \p argv.
+/// \return The thread support provided, which may be lower than requested
+inline thread initialise(int& argc, char**& argv, thread const thread_required)
 {
     // MPI thread level provided
     auto thread_provided = static_cast<int>(thread_required);
 
     MPI_Init_thread(&argc, &argv, static_cast<int>(thread_required), &thread_provided);
+
+    return static_cast<thread>(thread_provided);
 }
 
 /// Initialise a non-threaded MPI environment
-inline void initialise(int argc, char** argv) { MPI_Init(&argc, &argv); }
+inline void initialise(int& argc, char**& argv) { MPI_Init(&argc, &argv); }
+
+/// \return The thread support provided by the initialised MPI environment
+inline thread thread_level()
+{
+    int thread_provided;
+    MPI_Query_thread(&thread_provided);
+    return static_cast<thread>(thread_provided);
+}
 
 /// Finalise the MPI environment
 inline void finalise() { MPI_Finalize(); }
@@ -609,18 +1864,41 @@ inline void abort(int const error_code, communicator const comm = communicator::
 /// initialisation and destruction of the MPI environment.  Calls to
 /// \p MPI_Init and \p MPI_Finalize are no longer required as these are handled by the
 /// class constructor and destructor.
+///
+/// The arguments are passed on to MPI by reference, so the arguments consumed
+/// by MPI are removed from those seen by the rest of the program.
 class instance
 {
 public:
     /// Non-threaded MPI environment
-    instance(int argc, char** argv) { mpi::initialise(argc, argv); }
+    instance(int& argc, char**& argv)
+    {
+        mpi::initialise(argc, argv);
+        thread_provided = thread_level();
+    }
 
-    /// Threaded MPI environment
-    instance(int argc, char** argv, thread const thread_required)
+    /// Threaded MPI environment.  The thread support provided may be lower
+    /// than \p thread_required \sa thread_support()
+    instance(int& argc, char**& argv, thread const thread_required)
+        : thread_provided(mpi::initialise(argc, argv, thread_required))
     {
-        mpi::initialise(argc, argv, thread_required);
     }
 
+    instance(instance const&) = delete;
+    instance& operator=(instance const&) = delete;
+
     ~instance() { mpi::finalise(); }
+
+    /// \return The thread support provided by MPI
+    thread thread_support() const { return thread_provided; }
+
+    /// \return true if MPI provides at least the thread support \p level
+    bool supports(thread const level) const
+    {
+        return static_cast<int>(thread_provided) >= static_cast<int>(level);
+    }
+
+private:
+    thread thread_provided = thread::single;
 };
 }
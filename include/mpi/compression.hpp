@@ -0,0 +1,611 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/// \file compression.hpp
+/// \brief Lossless compressed transport for point to point vector messages
+
+namespace mpi
+{
+/// Lossless codecs available for compressed point to point messages
+enum class codec : std::uint8_t {
+    /// Send the (optionally shuffled) bytes unchanged
+    none,
+    /// Byte oriented run length encoding, cheap and effective on shuffled
+    /// exponent and sign bytes
+    run_length,
+    /// Hash based LZ77 matching, slower than run_length but catches repeated
+    /// byte sequences as well as runs
+    lz
+};
+
+/// compressed is a type tag requesting a lossless compressed transport for
+/// vector messages.  Each element is first split into its bytes and the bytes
+/// of equal significance are grouped together (byte shuffling), which exposes
+/// the redundancy in the sign and exponent bytes of smooth field data.  The
+/// shuffled bytes are then encoded with \p method.  Messages smaller than
+/// \p threshold bytes, or messages that do not shrink, are sent unencoded.
+/// \sa receive(compressed, int, int, communicator)
+struct compressed
+{
+    /// Payload size in bytes below which the message is sent unencoded
+    std::size_t threshold = 64 * 1024;
+    /// Encoding applied to the shuffled bytes
+    codec method = codec::lz;
+    /// Group the bytes of equal significance before encoding
+    bool shuffle = true;
+};
+
+namespace detail
+{
+/// Fixed size header that precedes every compressed message and allows the
+/// receiver to allocate the decoded vector after probing the message size
+struct compression_header
+{
+    std::uint64_t element_count;
+    std::uint64_t encoded_bytes;
+    std::uint64_t element_bytes;
+    std::uint8_t method;
+    std::uint8_t shuffled;
+};
+
+constexpr std::size_t compression_header_bytes = 8 + 8 + 8 + 2;
+
+inline void write_header(compression_header const& header, std::uint8_t* output)
+{
+    std::memcpy(output, &header.element_count, 8);
+    std::memcpy(output + 8, &header.encoded_bytes, 8);
+    std::memcpy(output + 16, &header.element_bytes, 8);
+    output[24] = header.method;
+    output[25] = header.shuffled;
+}
+
+inline compression_header read_header(std::uint8_t const* input)
+{
+    compression_header header;
+    std::memcpy(&header.element_count, input, 8);
+    std::memcpy(&header.encoded_bytes, input + 8, 8);
+    std::memcpy(&header.element_bytes, input + 16, 8);
+    header.method = input[24];
+    header.shuffled = input[25];
+    return header;
+}
+
+/// Group byte k of every element into the k-th plane of \p output.  The
+/// element width is a template parameter so the inner loop is unrolled.
+template <std::size_t element_bytes>
+inline void byte_shuffle(std::uint8_t const* input,
+                         std::size_t const element_count,
+                         std::uint8_t* output)
+{
+    for (std::size_t element = 0; element < element_count; ++element)
+    {
+        for (std::size_t byte = 0; byte < element_bytes; ++byte)
+        {
+            output[byte * element_count + element] = input[element * element_bytes + byte];
+        }
+    }
+}
+
+/// Inverse of byte_shuffle()
+template <std::size_t element_bytes>
+inline void byte_unshuffle(std::uint8_t const* input,
+                           std::size_t const element_count,
+                           std::uint8_t* output)
+{
+    for (std::size_t element = 0; element < element_count; ++element)
+    {
+        for (std::size_t byte = 0; byte < element_bytes; ++byte)
+        {
+            output[element * element_bytes + byte] = input[byte * element_count + element];
+        }
+    }
+}
+
+inline void byte_shuffle(std::uint8_t const* input,
+                         std::size_t const element_count,
+                         std::size_t const element_bytes,
+                         std::uint8_t* output)
+{
+    switch (element_bytes)
+    {
+        case 2: byte_shuffle<2>(input, element_count, output); break;
+        case 4: byte_shuffle<4>(input, element_count, output); break;
+        case 8: byte_shuffle<8>(input, element_count, output); break;
+        case 16: byte_shuffle<16>(input, element_count, output); break;
+        default:
+            for (std::size_t element = 0; element < element_count; ++element)
+            {
+                for (std::size_t byte = 0; byte < element_bytes; ++byte)
+                {
+                    output[byte * element_count + element] = input[element * element_bytes + byte];
+                }
+            }
+    }
+}
+
+inline void byte_unshuffle(std::uint8_t const* input,
+                           std::size_t const element_count,
+                           std::size_t const element_bytes,
+                           std::uint8_t* output)
+{
+    switch (element_bytes)
+    {
+        case 2: byte_unshuffle<2>(input, element_count, output); break;
+        case 4: byte_unshuffle<4>(input, element_count, output); break;
+        case 8: byte_unshuffle<8>(input, element_count, output); break;
+        case 16: byte_unshuffle<16>(input, element_count, output); break;
+        default:
+            for (std::size_t element = 0; element < element_count; ++element)
+            {
+                for (std::size_t byte = 0; byte < element_bytes; ++byte)
+                {
+                    output[element * element_bytes + byte] = input[byte * element_count + element];
+                }
+            }
+    }
+}
+
+/// Run length encoding in the PackBits format.  A control byte c < 128 is
+/// followed by c + 1 literal bytes, otherwise the next byte is repeated
+/// 257 - c times.
+inline void run_length_encode(std::uint8_t const* input,
+                              std::size_t const size,
+                              std::vector<std::uint8_t>& output)
+{
+    std::size_t position = 0;
+
+    while (position < size)
+    {
+        // Measure the run starting at the current position
+        std::size_t run = 1;
+        while (position + run < size && run < 128 && input[position + run] == input[position])
+        {
+            ++run;
+        }
+
+        if (run >= 3)
+        {
+            output.push_back(static_cast<std::uint8_t>(257 - run));
+            output.push_back(input[position]);
+            position += run;
+            continue;
+        }
+
+        // Collect literals until the next run of three or more
+        std::size_t const literal_start = position;
+        while (position < size && position - literal_start < 128)
+        {
+            if (position + 2 < size && input[position] == input[position + 1]
+                && input[position] == input[position + 2])
+            {
+                break;
+            }
+            ++position;
+        }
+        output.push_back(static_cast<std::uint8_t>(position - literal_start - 1));
+        output.insert(output.end(), input + literal_start, input + position);
+    }
+}
+
+inline void run_length_decode(std::uint8_t const* input,
+                              std::size_t const size,
+                              std::uint8_t* output,
+                              std::size_t const output_size)
+{
+    std::uint8_t const* const end = input + size;
+    std::size_t written = 0;
+
+    while (input < end)
+    {
+        std::size_t const control = *input++;
+
+        if (control < 128)
+        {
+            std::size_t const literals = control + 1;
+            if (static_cast<std::size_t>(end - input) < literals
+                || written + literals > output_size)
+            {
+                throw std::runtime_error("mpi::receive: corrupt run length payload");
+            }
+            std::memcpy(output + written, input, literals);
+            input += literals;
+            written += literals;
+        }
+        else
+        {
+            std::size_t const repeats = 257 - control;
+            if (input == end || written + repeats > output_size)
+            {
+                throw std::runtime_error("mpi::receive: corrupt run length payload");
+            }
+            std::memset(output + written, *input++, repeats);
+            written += repeats;
+        }
+    }
+    if (written != output_size)
+    {
+        throw std::runtime_error("mpi::receive: truncated run length payload");
+    }
+}
+
+inline void lz_write_length(std::size_t length, std::vector<std::uint8_t>& output)
+{
+    for (; length >= 255; length -= 255)
+    {
+        output.push_back(255);
+    }
+    output.push_back(static_cast<std::uint8_t>(length));
+}
+
+inline std::uint32_t lz_read_word(std::uint8_t const* input)
+{
+    std::uint32_t word;
+    std::memcpy(&word, input, sizeof(word));
+    return word;
+}
+
+/// LZ77 encoding with a single entry hash table in the spirit of LZ4.  Each
+/// sequence is a token (literal count in the high nibble, match length - 4 in
+/// the low nibble) with extension bytes for long lengths, the literals, then a
+/// two byte offset and extension bytes for the match.  The final sequence
+/// carries literals only.
+inline void lz_encode(std::uint8_t const* input,
+                      std::size_t const size,
+                      std::vector<std::uint8_t>& output)
+{
+    constexpr std::size_t minimum_match = 4;
+    constexpr std::size_t maximum_offset = 65535;
+    constexpr int hash_bits = 14;
+
+    std::vector<std::uint32_t> hash_table(std::size_t(1) << hash_bits, 0);
+
+    auto const hash = [](std::uint32_t const word) {
+        return (word * 2654435761u) >> (32 - hash_bits);
+    };
+
+    auto const emit = [&](std::size_t const literal_start,
+                          std::size_t const literal_count,
+                          std::size_t const match_length,
+                          std::size_t const offset) {
+        auto const literal_nibble = std::min<std::size_t>(literal_count, 15);
+        auto const match_nibble = match_length == 0
+                                      ? 0
+                                      : std::min<std::size_t>(match_length - minimum_match, 15);
+
+        output.push_back(static_cast<std::uint8_t>(literal_nibble << 4 | match_nibble));
+
+        if (literal_count >= 15) lz_write_length(literal_count - 15, output);
+
+        output.insert(output.end(), input + literal_start, input + literal_start + literal_count);
+
+        if (match_length == 0) return;
+
+        output.push_back(static_cast<std::uint8_t>(offset & 0xFF));
+        output.push_back(static_cast<std::uint8_t>(offset >> 8));
+
+        if (match_length - minimum_match >= 15)
+        {
+            lz_write_length(match_length - minimum_match - 15, output);
+        }
+    };
+
+    std::size_t literal_start = 0;
+    std::size_t position = 0;
+
+    // Number of failed searches, used to step faster through incompressible data
+    std::size_t misses = 0;
+
+    while (position + minimum_match <= size)
+    {
+        std::uint32_t const word = lz_read_word(input + position);
+        auto& slot = hash_table[hash(word)];
+
+        // Table entries are stored one past the position so zero means empty
+        std::size_t const candidate = slot;
+        slot = static_cast<std::uint32_t>(position + 1);
+
+        if (candidate == 0 || position + 1 - candidate > maximum_offset
+            || lz_read_word(input + candidate - 1) != word)
+        {
+            position += 1 + (misses++ >> 6);
+            continue;
+        }
+        misses = 0;
+
+        std::size_t const match_start = candidate - 1;
+        std::size_t match_length = minimum_match;
+
+        // Extend the match a word at a time, then byte by byte
+        while (position + match_length + sizeof(std::uint64_t) <= size)
+        {
+            std::uint64_t lhs, rhs;
+            std::memcpy(&lhs, input + match_start + match_length, sizeof(lhs));
+            std::memcpy(&rhs, input + position + match_length, sizeof(rhs));
+            if (lhs != rhs) break;
+            match_length += sizeof(std::uint64_t);
+        }
+        while (position + match_length < size
+               && input[match_start + match_length] == input[position + match_length])
+        {
+            ++match_length;
+        }
+
+        emit(literal_start, position - literal_start, match_length, position - match_start);
+
+        position += match_length;
+        literal_start = position;
+    }
+    emit(literal_start, size - literal_start, 0, 0);
+}
+
+inline void lz_decode(std::uint8_t const* input,
+                      std::size_t const size,
+                      std::uint8_t* output,
+                      std::size_t const output_size)
+{
+    std::uint8_t const* const end = input + size;
+    std::size_t written = 0;
+
+    auto const read_length = [&](std::size_t length) {
+        std::uint8_t extension;
+        do
+        {
+            if (input == end) throw std::runtime_error("mpi::receive: corrupt lz payload");
+            extension = *input++;
+            length += extension;
+        } while (extension == 255);
+        return length;
+    };
+
+    while (input < end)
+    {
+        std::uint8_t const token = *input++;
+
+        std::size_t literal_count = token >> 4;
+        if (literal_count == 15) literal_count = read_length(literal_count);
+
+        if (static_cast<std::size_t>(end - input) < literal_count
+            || written + literal_count > output_size)
+        {
+            throw std::runtime_error("mpi::receive: corrupt lz payload");
+        }
+        std::memcpy(output + written, input, literal_count);
+        input += literal_count;
+        written += literal_count;
+
+        // The final sequence has no match
+        if (input == end) break;
+
+        if (end - input < 2) throw std::runtime_error("mpi::receive: corrupt lz payload");
+
+        std::size_t const offset = input[0] | static_cast<std::size_t>(input[1]) << 8;
+        input += 2;
+
+        std::size_t match_length = token & 0x0F;
+        if (match_length == 15) match_length = read_length(match_length);
+        match_length += 4;
+
+        if (offset == 0 || offset > written || written + match_length > output_size)
+        {
+            throw std::runtime_error("mpi::receive: corrupt lz payload");
+        }
+
+        std::uint8_t const* source = output + written - offset;
+
+        if (offset >= match_length)
+        {
+            std::memcpy(output + written, source, match_length);
+        }
+        else
+        {
+            // Byte by byte copy as the match overlaps the output
+            for (std::size_t index = 0; index < match_length; ++index)
+            {
+                output[written + index] = source[index];
+            }
+        }
+        written += match_length;
+    }
+    if (written != output_size)
+    {
+        throw std::runtime_error("mpi::receive: truncated lz payload");
+    }
+}
+
+/// Encode \p element_count elements of \p element_bytes each into a message
+/// consisting of a compression_header followed by the payload
+inline std::vector<std::uint8_t> compress_message(void const* data,
+                                                  std::size_t const element_count,
+                                                  std::size_t const element_bytes,
+                                                  compressed const& options)
+{
+    std::size_t const raw_bytes = element_count * element_bytes;
+
+    auto const* raw = static_cast<std::uint8_t const*>(data);
+
+    compression_header header{element_count,
+                              raw_bytes,
+                              element_bytes,
+                              static_cast<std::uint8_t>(codec::none),
+                              0};
+
+    std::vector<std::uint8_t> message(compression_header_bytes);
+
+    if (raw_bytes >= options.threshold && options.method != codec::none)
+    {
+        std::vector<std::uint8_t> shuffled;
+        if (options.shuffle && element_bytes > 1)
+        {
+            shuffled.resize(raw_bytes);
+            byte_shuffle(raw, element_count, element_bytes, shuffled.data());
+        }
+        auto const* source = shuffled.empty() ? raw : shuffled.data();
+
+        message.reserve(compression_header_bytes + raw_bytes);
+
+        if (options.method == codec::run_length)
+        {
+            run_length_encode(source, raw_bytes, message);
+        }
+        else
+        {
+            lz_encode(source, raw_bytes, message);
+        }
+
+        std::size_t const encoded_bytes = message.size() - compression_header_bytes;
+
+        if (encoded_bytes < raw_bytes)
+        {
+            header.encoded_bytes = encoded_bytes;
+            header.method = static_cast<std::uint8_t>(options.method);
+            header.shuffled = !shuffled.empty();
+
+            write_header(header, message.data());
+
+            return message;
+        }
+        // Incompressible data is sent as is
+        message.resize(compression_header_bytes);
+    }
+
+    message.insert(message.end(), raw, raw + raw_bytes);
+
+    write_header(header, message.data());
+
+    return message;
+}
+
+/// Decode a message produced by compress_message into \p data which must have
+/// space for header.element_count elements
+inline void decompress_message(std::vector<std::uint8_t> const& message,
+                               compression_header const& header,
+                               void* data)
+{
+    std::size_t const raw_bytes = header.element_count * header.element_bytes;
+
+    auto const* payload = message.data() + compression_header_bytes;
+    auto* output = static_cast<std::uint8_t*>(data);
+
+    if (message.size() - compression_header_bytes != header.encoded_bytes)
+    {
+        throw std::runtime_error("mpi::receive: compressed message size mismatch");
+    }
+
+    if (static_cast<codec>(header.method) == codec::none)
+    {
+        if (header.encoded_bytes != raw_bytes)
+        {
+            throw std::runtime_error("mpi::receive: unencoded message size mismatch");
+        }
+        std::memcpy(output, payload, raw_bytes);
+        return;
+    }
+
+    std::vector<std::uint8_t> shuffled(header.shuffled ? raw_bytes : 0);
+    auto* destination = header.shuffled ? shuffled.data() : output;
+
+    switch (static_cast<codec>(header.method))
+    {
+        case codec::run_length:
+            run_length_decode(payload, header.encoded_bytes, destination, raw_bytes);
+            break;
+        case codec::lz: lz_decode(payload, header.encoded_bytes, destination, raw_bytes); break;
+        default: throw std::runtime_error("mpi::receive: unknown compression codec");
+    }
+
+    if (header.shuffled)
+    {
+        byte_unshuffle(shuffled.data(), header.element_count, header.element_bytes, output);
+    }
+}
+}
+
+/// Perform a blocking MPI send of a vector using the compressed transport.
+/// The message must be received with the compressed receive overload.
+/// \tparam T Vector type to send
+/// \param options Compression threshold and codec \sa compressed
+/// \param send_vector Vector of data to send
+/// \param destination_process Where to send the data
+/// \param message_tag Add a tag to the message
+/// \param comm Communicator type
+template <typename T>
+inline auto send(compressed const& options,
+                 T const& send_vector,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value>
+{
+    auto const message = detail::compress_message(send_vector.data(),
+                                                  send_vector.size(),
+                                                  sizeof(typename T::value_type),
+                                                  options);
+    MPI_Send(const_cast<std::uint8_t*>(message.data()),
+             message.size(),
+             MPI_BYTE,
+             destination_process,
+             message_tag,
+             comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF);
+}
+
+/// Perform a blocking MPI receive of a vector sent with the compressed
+/// transport.  The message size is probed, the header gives the number of
+/// elements to allocate and the payload is decoded into the returned vector.
+/// \tparam T Vector type to receive
+/// \param source_process Processor to receive from
+/// \param message_tag Matching tag to the message
+/// \param comm Communicator type
+/// \return Received vector of type T
+template <typename T>
+inline auto receive(compressed,
+                    int const source_process,
+                    int const message_tag = 0,
+                    communicator const comm = communicator::world)
+    -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value, T>
+{
+    ::mpi::status probe_status;
+    MPI_Message matched_message;
+
+    MPI_Mprobe(source_process,
+               message_tag,
+               comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+               &matched_message,
+               &probe_status);
+
+    int buffer_size;
+
+    MPI_Get_count(&probe_status, MPI_BYTE, &buffer_size);
+
+    std::vector<std::uint8_t> message(buffer_size);
+
+    MPI_Mrecv(message.data(), message.size(), MPI_BYTE, &matched_message, MPI_STATUS_IGNORE);
+
+    if (message.size() < detail::compression_header_bytes)
+    {
+        throw std::runtime_error("mpi::receive: compressed message is missing its header");
+    }
+
+    auto const header = detail::read_header(message.data());
+
+    if (header.element_bytes != sizeof(typename T::value_type))
+    {
+        throw std::runtime_error("mpi::receive: compressed message has a different value type");
+    }
+
+    T receive_buffer(header.element_count);
+
+    detail::decompress_message(message, header, receive_buffer.data());
+
+    return receive_buffer;
+}
+}
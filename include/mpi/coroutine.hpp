@@ -0,0 +1,443 @@
+
+#pragma once
+
+#if __cplusplus < 202002L
+#error "mpi/coroutine.hpp requires C++20, configure with -DENABLE_COROUTINES=ON"
+#endif
+
+#include "mpi.hpp"
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// \file coroutine.hpp
+/// \brief C++20 coroutines resumed as nonblocking operations complete
+
+namespace mpi
+{
+template <typename T = void>
+class task;
+
+namespace detail
+{
+/// Address, count and datatype of a value or a contiguous container
+struct message_buffer
+{
+    void* data;
+    int count;
+    MPI_Datatype datatype;
+};
+
+template <typename T>
+    requires has_data_type<T>::value
+inline message_buffer buffer_of(T& value)
+{
+    return {&value, 1, data_type<T>::value_type()};
+}
+
+template <typename T>
+    requires is_container<T>::value
+inline message_buffer buffer_of(T& data)
+{
+    return {data.data(),
+            static_cast<int>(data.size()),
+            data_type<typename T::value_type>::value_type()};
+}
+
+inline MPI_Comm handle_of(communicator const comm)
+{
+    return comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF;
+}
+
+/// Resumes the coroutine awaiting a task, if any, when the task finishes
+struct final_awaiter
+{
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise_Tp>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise_Tp> finished) noexcept
+    {
+        auto const continuation = finished.promise().continuation;
+        return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+};
+
+/// Parts of a task promise that do not depend on the result type
+class promise_base
+{
+public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    void rethrow_if_failed()
+    {
+        if (exception) std::rethrow_exception(exception);
+    }
+
+    std::coroutine_handle<> continuation;
+
+private:
+    std::exception_ptr exception;
+};
+
+template <typename T>
+class promise : public promise_base
+{
+public:
+    task<T> get_return_object();
+
+    template <typename Value_Tp>
+    void return_value(Value_Tp&& returned)
+    {
+        value.emplace(std::forward<Value_Tp>(returned));
+    }
+
+    T result()
+    {
+        rethrow_if_failed();
+        return std::move(*value);
+    }
+
+private:
+    std::optional<T> value;
+};
+
+template <>
+class promise<void> : public promise_base
+{
+public:
+    task<void> get_return_object();
+
+    void return_void() {}
+
+    void result() { rethrow_if_failed(); }
+};
+}
+
+/// task is the return type of a coroutine run by a scheduler.  A task starts
+/// when it is awaited by another task or when it is spawned on a scheduler.
+/// Awaiting a task returns its result or rethrows its exception.
+/// \tparam T Result type
+template <typename T>
+class task
+{
+public:
+    using promise_type = detail::promise<T>;
+
+public:
+    explicit task(std::coroutine_handle<promise_type> coroutine) : coroutine(coroutine) {}
+
+    task(task&& other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+
+    task& operator=(task&& other) noexcept
+    {
+        std::swap(coroutine, other.coroutine);
+        return *this;
+    }
+
+    task(task const&) = delete;
+    task& operator=(task const&) = delete;
+
+    ~task()
+    {
+        if (coroutine) coroutine.destroy();
+    }
+
+    bool done() const { return !coroutine || coroutine.done(); }
+
+    auto operator co_await() noexcept
+    {
+        struct task_awaiter
+        {
+            std::coroutine_handle<promise_type> awaited;
+
+            bool await_ready() noexcept { return !awaited || awaited.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                awaited.promise().continuation = awaiting;
+                return awaited;
+            }
+
+            T await_resume() { return awaited.promise().result(); }
+        };
+        return task_awaiter{coroutine};
+    }
+
+private:
+    friend class scheduler;
+
+    std::coroutine_handle<promise_type> coroutine;
+};
+
+template <typename T>
+inline task<T> detail::promise<T>::get_return_object()
+{
+    return task<T>{std::coroutine_handle<promise<T>>::from_promise(*this)};
+}
+
+inline task<void> detail::promise<void>::get_return_object()
+{
+    return task<void>{std::coroutine_handle<promise<void>>::from_promise(*this)};
+}
+
+/// scheduler runs coroutines on a single thread.  A coroutine awaiting a
+/// nonblocking operation is suspended and its request is added to a list that
+/// is tested with \p MPI_Testsome, resuming each coroutine as its operation
+/// completes.  Many concurrent exchanges can therefore be written as
+/// sequential code without a thread or a hand written state machine per
+/// exchange.
+///
+/// The buffers of an operation are only accessed while the awaiting coroutine
+/// is suspended, so they must stay alive until the co_await returns.
+class scheduler
+{
+public:
+    /// Awaitable suspending the calling coroutine until a request completes
+    class request_awaiter
+    {
+    public:
+        request_awaiter(scheduler& owner, request pending) : owner(owner), pending(pending) {}
+
+        bool await_ready()
+        {
+            int is_complete = 0;
+            MPI_Test(&pending, &is_complete, &completed);
+            return is_complete != 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting)
+        {
+            owner.park(pending, &completed, awaiting);
+        }
+
+        status await_resume() { return completed; }
+
+    private:
+        scheduler& owner;
+        request pending;
+        status completed{};
+    };
+
+    /// Awaitable for a nonblocking collective producing a value.  The operation
+    /// is started once the awaitable is in its final place in the coroutine.
+    template <typename Result_Tp, typename Start_Tp>
+    class collective_awaiter
+    {
+    public:
+        collective_awaiter(scheduler& owner, Result_Tp result, Start_Tp start)
+            : owner(owner), result(std::move(result)), start(std::move(start))
+        {
+        }
+
+        bool await_ready()
+        {
+            pending = start(result);
+
+            int is_complete = 0;
+            MPI_Test(&pending, &is_complete, MPI_STATUS_IGNORE);
+            return is_complete != 0;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting)
+        {
+            owner.park(pending, nullptr, awaiting);
+        }
+
+        Result_Tp await_resume() { return std::move(result); }
+
+    private:
+        scheduler& owner;
+        Result_Tp result;
+        Start_Tp start;
+        request pending = MPI_REQUEST_NULL;
+    };
+
+public:
+    scheduler() = default;
+
+    scheduler(scheduler const&) = delete;
+    scheduler& operator=(scheduler const&) = delete;
+
+    /// Start \p spawned when run() is called.  The scheduler keeps the task.
+    void spawn(task<void> spawned)
+    {
+        ready.push_back(spawned.coroutine);
+        spawned_tasks.push_back(std::move(spawned));
+    }
+
+    /// Run the spawned tasks until all of them have finished
+    /// \throw The first exception thrown by a spawned task
+    void run()
+    {
+        for (;;)
+        {
+            while (!ready.empty())
+            {
+                auto const next = ready.front();
+                ready.pop_front();
+                next.resume();
+            }
+
+            if (requests.empty()) break;
+
+            indices.resize(requests.size());
+            statuses.resize(requests.size());
+
+            int completions = 0;
+            MPI_Testsome(requests.size(),
+                         requests.data(),
+                         &completions,
+                         indices.data(),
+                         statuses.data());
+
+            for (int completion = 0; completion < completions; ++completion)
+            {
+                auto& waiter = waiters[indices[completion]];
+
+                if (waiter.completed) *waiter.completed = statuses[completion];
+
+                ready.push_back(waiter.coroutine);
+            }
+
+            if (completions > 0 && completions != MPI_UNDEFINED) remove_completed();
+        }
+
+        auto finished = std::move(spawned_tasks);
+        spawned_tasks.clear();
+
+        for (auto& spawned : finished) spawned.coroutine.promise().result();
+    }
+
+    /// \return An awaitable for an operation started elsewhere
+    request_awaiter wait_for(request const pending) { return {*this, pending}; }
+
+    /// \return An awaitable sending \p data, a built-in value or vector
+    template <typename T>
+    request_awaiter send(T const& data,
+                         int const destination_process,
+                         int const message_tag = 0,
+                         communicator const comm = communicator::world)
+    {
+        return {*this, mpi::send(async{}, data, destination_process, message_tag, comm)};
+    }
+
+    /// \return An awaitable receiving into \p data, a built-in value or a
+    ///         vector already sized to the message
+    template <typename T>
+    request_awaiter receive(T& data,
+                            int const source_process,
+                            int const message_tag = 0,
+                            communicator const comm = communicator::world)
+    {
+        return {*this, mpi::receive(async{}, data, source_process, message_tag, comm)};
+    }
+
+    /// \return An awaitable completing once all processes have reached it
+    auto barrier(communicator const comm = communicator::world)
+    {
+        int unused = 0;
+        return collective_awaiter(*this, unused, [comm](int&) {
+            request pending;
+            MPI_Ibarrier(detail::handle_of(comm), &pending);
+            return pending;
+        });
+    }
+
+    /// \return An awaitable producing the reduction of \p local_data, a
+    ///         built-in value or vector, over all processes
+    template <typename T, typename Operation_Tp>
+    auto all_reduce(T const& local_data,
+                    Operation_Tp&& operation,
+                    communicator const comm = communicator::world)
+    {
+        MPI_Op const op = operation.tag;
+
+        return collective_awaiter(*this, local_data, [comm, op](T& reduced) {
+            auto const buffer = detail::buffer_of(reduced);
+
+            request pending;
+            MPI_Iallreduce(MPI_IN_PLACE,
+                           buffer.data,
+                           buffer.count,
+                           buffer.datatype,
+                           op,
+                           detail::handle_of(comm),
+                           &pending);
+            return pending;
+        });
+    }
+
+    /// \return An awaitable producing \p local_data of \p host_processor on
+    ///         all processes.  Vectors must already have the broadcast size.
+    template <typename T>
+    auto broadcast(T const& local_data,
+                   int const host_processor = 0,
+                   communicator const comm = communicator::world)
+    {
+        return collective_awaiter(*this, local_data, [comm, host_processor](T& data) {
+            auto const buffer = detail::buffer_of(data);
+
+            request pending;
+            MPI_Ibcast(buffer.data,
+                       buffer.count,
+                       buffer.datatype,
+                       host_processor,
+                       detail::handle_of(comm),
+                       &pending);
+            return pending;
+        });
+    }
+
+private:
+    struct waiter
+    {
+        std::coroutine_handle<> coroutine;
+        status* completed;
+    };
+
+    void park(request const pending, status* completed, std::coroutine_handle<> awaiting)
+    {
+        requests.push_back(pending);
+        waiters.push_back({awaiting, completed});
+    }
+
+    /// Completed requests have been set to MPI_REQUEST_NULL
+    void remove_completed()
+    {
+        std::size_t kept = 0;
+        for (std::size_t index = 0; index < requests.size(); ++index)
+        {
+            if (requests[index] == MPI_REQUEST_NULL) continue;
+
+            requests[kept] = requests[index];
+            waiters[kept] = waiters[index];
+            ++kept;
+        }
+        requests.resize(kept);
+        waiters.resize(kept);
+    }
+
+private:
+    std::deque<std::coroutine_handle<>> ready;
+
+    /// Requests being tested and the coroutines waiting for them
+    std::vector<request> requests;
+    std::vector<waiter> waiters;
+
+    std::vector<int> indices;
+    std::vector<status> statuses;
+
+    std::vector<task<void>> spawned_tasks;
+};
+}
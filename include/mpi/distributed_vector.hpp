@@ -0,0 +1,471 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/// \file distributed_vector.hpp
+/// \brief Block distributed vector with ghost exchange and global reductions
+
+namespace mpi
+{
+/// block is a partition tag assigning one contiguous range of nearly equal
+/// size to each process in rank order
+struct block
+{
+};
+
+/// block_cyclic is a partition tag dealing out blocks of \p block_size
+/// consecutive indices to the processes in turn
+struct block_cyclic
+{
+    std::size_t block_size;
+};
+
+namespace detail
+{
+/// true if \p T is a partition tag
+template <typename T>
+struct is_layout : std::false_type
+{
+};
+
+template <>
+struct is_layout<block> : std::true_type
+{
+};
+
+template <>
+struct is_layout<block_cyclic> : std::true_type
+{
+};
+}
+
+/// partition maps global indices onto (process, local index) pairs
+class partition
+{
+public:
+    partition(std::size_t const global_size, int const processes, block)
+        : global_entries(global_size), processes(processes), block_size(0)
+    {
+    }
+
+    partition(std::size_t const global_size, int const processes, block_cyclic const layout)
+        : global_entries(global_size), processes(processes), block_size(layout.block_size)
+    {
+    }
+
+    std::size_t global_size() const { return global_entries; }
+
+    /// \return The process owning \p global_index.  Throws std::runtime_error
+    /// if the index is not less than global_size().
+    int owner(std::size_t const global_index) const
+    {
+        check_range(global_index);
+
+        if (is_cyclic()) return (global_index / block_size) % processes;
+
+        // The first (global_size % processes) processes own one extra entry
+        auto const base = global_entries / processes;
+        auto const remainder = global_entries % processes;
+
+        auto const boundary = remainder * (base + 1);
+
+        return global_index < boundary ? global_index / (base + 1)
+                                       : remainder + (global_index - boundary) / base;
+    }
+
+    /// \return The index of \p global_index in the storage of its owner
+    std::size_t local_index(std::size_t const global_index) const
+    {
+        check_range(global_index);
+
+        if (is_cyclic())
+        {
+            return global_index / block_size / processes * block_size + global_index % block_size;
+        }
+        return global_index - first_index(owner(global_index));
+    }
+
+    /// \return The global index of entry \p local_index on \p process
+    std::size_t global_index(int const process, std::size_t const local_index) const
+    {
+        if (is_cyclic())
+        {
+            return (local_index / block_size * processes + process) * block_size
+                   + local_index % block_size;
+        }
+        return first_index(process) + local_index;
+    }
+
+    /// \return The number of entries owned by \p process
+    std::size_t local_size(int const process) const
+    {
+        if (is_cyclic())
+        {
+            auto const blocks = global_entries / block_size;
+            auto const partial_block = global_entries % block_size;
+
+            auto size = blocks / processes * block_size;
+
+            auto const remaining_blocks = static_cast<int>(blocks % processes);
+
+            if (process < remaining_blocks)
+            {
+                size += block_size;
+            }
+            else if (process == remaining_blocks)
+            {
+                size += partial_block;
+            }
+            return size;
+        }
+        return global_entries / processes
+               + (static_cast<std::size_t>(process) < global_entries % processes ? 1 : 0);
+    }
+
+private:
+    bool is_cyclic() const { return block_size > 0; }
+
+    /// An index past the end has no owner, and with fewer entries than
+    /// processes the block mapping would divide by zero
+    void check_range(std::size_t const global_index) const
+    {
+        if (global_index >= global_entries)
+        {
+            throw std::runtime_error("mpi::partition: global index "
+                                     + std::to_string(global_index) + " is outside [0, "
+                                     + std::to_string(global_entries) + ")");
+        }
+    }
+
+    std::size_t first_index(int const process) const
+    {
+        auto const base = global_entries / processes;
+        auto const remainder = global_entries % processes;
+
+        return process * base + std::min<std::size_t>(process, remainder);
+    }
+
+private:
+    std::size_t global_entries;
+    int processes;
+    /// Zero for a block partition
+    std::size_t block_size;
+};
+
+/// distributed_vector holds the entries of a global vector owned by this
+/// process according to a partition, followed by read-only copies (ghosts) of
+/// entries owned by other processes.
+///
+/// The ghosts are chosen once with set_ghosts(), which builds a persistent
+/// communication plan.  Each later update_ghosts() call is then a single
+/// start and wait of persistent requests, where the values sent are picked
+/// straight out of the local storage with indexed datatypes.  The update can
+/// be split into start_ghost_update() and finish_ghost_update() to overlap it
+/// with computation on the owned entries.
+///
+/// Iterators cover the owned entries only.  All functions taking no index are
+/// collective.
+/// \tparam T Arithmetic value type
+template <typename T>
+class distributed_vector
+{
+    static_assert(std::is_arithmetic<T>::value,
+                  "mpi::distributed_vector requires arithmetic values");
+
+public:
+    using value_type = T;
+    using iterator = typename std::vector<T>::iterator;
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+public:
+    /// Create a block partitioned vector
+    explicit distributed_vector(std::size_t const global_size,
+                                T const value = T{},
+                                communicator const comm = communicator::world)
+        : distributed_vector(global_size, block{}, value, comm)
+    {
+    }
+
+    /// Create a vector with the given partition \sa block \sa block_cyclic
+    template <typename Layout_Tp, typename = std::enable_if_t<detail::is_layout<Layout_Tp>::value>>
+    distributed_vector(std::size_t const global_size,
+                       Layout_Tp const distribution,
+                       T const value = T{},
+                       communicator const comm = communicator::world)
+        : comm(comm),
+          layout(global_size, mpi::size(comm), distribution),
+          owned_entries(this->layout.local_size(mpi::rank(comm))),
+          storage(owned_entries, value)
+    {
+        MPI_Comm_dup(comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+                     &ghost_communicator);
+    }
+
+    distributed_vector(distributed_vector const&) = delete;
+    distributed_vector& operator=(distributed_vector const&) = delete;
+
+    ~distributed_vector()
+    {
+        free_plan();
+        MPI_Comm_free(&ghost_communicator);
+    }
+
+    /// \return The partition of the global indices
+    partition const& distribution() const { return layout; }
+
+    std::size_t global_size() const { return layout.global_size(); }
+
+    /// \return The number of entries owned by this process
+    std::size_t local_size() const { return owned_entries; }
+
+    /// \return The number of ghost entries held by this process
+    std::size_t ghost_size() const { return storage.size() - owned_entries; }
+
+    iterator begin() { return storage.begin(); }
+    iterator end() { return storage.begin() + owned_entries; }
+
+    const_iterator begin() const { return storage.begin(); }
+    const_iterator end() const { return storage.begin() + owned_entries; }
+
+    /// \return The owned entry with local index \p local_index
+    T& operator[](std::size_t const local_index) { return storage[local_index]; }
+    T const& operator[](std::size_t const local_index) const { return storage[local_index]; }
+
+    /// \return Pointer to the owned entries, followed by the ghost entries
+    T* data() { return storage.data(); }
+    T const* data() const { return storage.data(); }
+
+    /// \return true if \p global_index is owned by this process
+    bool owns(std::size_t const global_index) const
+    {
+        return layout.owner(global_index) == mpi::rank(comm);
+    }
+
+    /// \return The global index of the owned entry \p local_index
+    std::size_t global_index(std::size_t const local_index) const
+    {
+        return layout.global_index(mpi::rank(comm), local_index);
+    }
+
+    /// \return The value at \p global_index, which must be owned or a ghost
+    T const& global(std::size_t const global_index) const
+    {
+        if (owns(global_index)) return storage[layout.local_index(global_index)];
+
+        return storage[owned_entries + ghost_slots.at(global_index)];
+    }
+
+    /// Collectively choose the entries owned by other processes that this
+    /// process reads and build the ghost update plan.  Indices owned by this
+    /// process and duplicates are ignored.  The ghost values are undefined
+    /// until the first update_ghosts().  Throws std::runtime_error if an index
+    /// is not less than global_size().
+    /// \param global_indices Global indices of the entries to mirror locally
+    void set_ghosts(std::vector<std::size_t> global_indices)
+    {
+        // An index past the end has no owner to request it from
+        if (std::any_of(std::begin(global_indices),
+                        std::end(global_indices),
+                        [&](std::size_t const index) { return index >= global_size(); }))
+        {
+            throw std::runtime_error("mpi::distributed_vector::set_ghosts: a ghost index is "
+                                     "outside the global vector");
+        }
+
+        free_plan();
+
+        auto const processes = mpi::size(comm);
+
+        global_indices.erase(std::remove_if(std::begin(global_indices),
+                                            std::end(global_indices),
+                                            [&](std::size_t index) { return owns(index); }),
+                             std::end(global_indices));
+
+        // Group the ghosts by owner so the values from each owner are contiguous
+        std::sort(std::begin(global_indices),
+                  std::end(global_indices),
+                  [&](std::size_t const lhs, std::size_t const rhs) {
+                      auto const lhs_owner = layout.owner(lhs), rhs_owner = layout.owner(rhs);
+                      return lhs_owner < rhs_owner || (lhs_owner == rhs_owner && lhs < rhs);
+                  });
+        global_indices.erase(std::unique(std::begin(global_indices), std::end(global_indices)),
+                             std::end(global_indices));
+
+        ghost_slots.clear();
+
+        std::vector<int> receive_counts(processes, 0);
+        std::vector<long long> requested(global_indices.size());
+
+        for (std::size_t slot = 0; slot < global_indices.size(); ++slot)
+        {
+            ghost_slots.emplace(global_indices[slot], slot);
+            ++receive_counts[layout.owner(global_indices[slot])];
+            requested[slot] = global_indices[slot];
+        }
+
+        // Tell each owner which of its entries this process needs
+        std::vector<long long> requested_from_me;
+        auto const send_counts = detail::all_to_allv(requested,
+                                                     receive_counts,
+                                                     requested_from_me,
+                                                     data_type<long long>::value_type(),
+                                                     comm);
+
+        storage.resize(owned_entries + global_indices.size());
+
+        // The values sent to each process are read in place from the storage
+        std::size_t offset = 0;
+        for (int process = 0; process < processes; ++process)
+        {
+            if (send_counts[process] == 0) continue;
+
+            std::vector<int> displacements(send_counts[process]);
+            for (int entry = 0; entry < send_counts[process]; ++entry)
+            {
+                displacements[entry] = layout.local_index(requested_from_me[offset + entry]);
+            }
+            offset += send_counts[process];
+
+            MPI_Datatype indexed;
+            MPI_Type_create_indexed_block(displacements.size(),
+                                          1,
+                                          displacements.data(),
+                                          data_type<T>::value_type(),
+                                          &indexed);
+            send_types.emplace_back(indexed);
+
+            plan.emplace_back();
+            MPI_Send_init(storage.data(),
+                          1,
+                          send_types.back().value_type(),
+                          process,
+                          0,
+                          ghost_communicator,
+                          &plan.back());
+        }
+
+        offset = owned_entries;
+        for (int process = 0; process < processes; ++process)
+        {
+            if (receive_counts[process] == 0) continue;
+
+            plan.emplace_back();
+            MPI_Recv_init(storage.data() + offset,
+                          receive_counts[process],
+                          data_type<T>::value_type(),
+                          process,
+                          0,
+                          ghost_communicator,
+                          &plan.back());
+
+            offset += receive_counts[process];
+        }
+    }
+
+    /// Start refreshing the ghost entries from their owners.  The owned
+    /// entries must not be modified until finish_ghost_update() returns.
+    void start_ghost_update()
+    {
+        if (!plan.empty()) MPI_Startall(plan.size(), plan.data());
+    }
+
+    /// Wait until the ghost entries have been refreshed
+    void finish_ghost_update()
+    {
+        if (!plan.empty()) MPI_Waitall(plan.size(), plan.data(), MPI_STATUSES_IGNORE);
+    }
+
+    /// Refresh the ghost entries from their owners
+    void update_ghosts()
+    {
+        start_ghost_update();
+        finish_ghost_update();
+    }
+
+    /// \return The communicator the vector is distributed over
+    communicator communicator_type() const { return comm; }
+
+private:
+    void free_plan()
+    {
+        for (auto& persistent_request : plan) MPI_Request_free(&persistent_request);
+        plan.clear();
+        send_types.clear();
+    }
+
+private:
+    communicator comm;
+
+    /// Private duplicate of the communicator so ghost messages never match
+    /// user messages
+    MPI_Comm ghost_communicator;
+
+    partition layout;
+
+    std::size_t owned_entries;
+
+    /// Owned entries followed by the ghost entries grouped by owner
+    std::vector<T> storage;
+
+    /// Position of each ghost after the owned entries
+    std::unordered_map<std::size_t, std::size_t> ghost_slots;
+
+    /// Persistent send and receive requests of the ghost update
+    std::vector<request> plan;
+    std::vector<derived_type> send_types;
+};
+
+/// \return The global inner product of \p x and \p y, which must have the
+/// same partition
+template <typename T>
+inline T dot(distributed_vector<T> const& x, distributed_vector<T> const& y)
+{
+    return all_reduce(std::inner_product(x.begin(), x.end(), y.begin(), T{}),
+                      sum{},
+                      x.communicator_type());
+}
+
+/// \return The global Euclidean norm of \p x
+template <typename T>
+inline T norm(distributed_vector<T> const& x)
+{
+    return std::sqrt(dot(x, x));
+}
+
+/// \return The global sum of the entries of \p x
+template <typename T>
+inline T sum_of(distributed_vector<T> const& x)
+{
+    return all_reduce(std::accumulate(x.begin(), x.end(), T{}), sum{}, x.communicator_type());
+}
+
+/// \return The global maximum entry of \p x
+template <typename T>
+inline T max_of(distributed_vector<T> const& x)
+{
+    auto const local_max = x.local_size() > 0 ? *std::max_element(x.begin(), x.end())
+                                              : std::numeric_limits<T>::lowest();
+    return all_reduce(local_max, max{}, x.communicator_type());
+}
+
+/// \return The global minimum entry of \p x
+template <typename T>
+inline T min_of(distributed_vector<T> const& x)
+{
+    auto const local_min = x.local_size() > 0 ? *std::min_element(x.begin(), x.end())
+                                              : std::numeric_limits<T>::max();
+    return all_reduce(local_min, min{}, x.communicator_type());
+}
+}
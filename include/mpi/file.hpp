@@ -0,0 +1,393 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// \file file.hpp
+/// \brief Collective parallel file input and output (MPI-IO)
+
+namespace mpi
+{
+/// Access modes for opening a file.  Opening for \p write creates the file
+/// or truncates an existing one to zero length, while \p read_write keeps the
+/// existing contents.
+enum class file_mode : int {
+    read = MPI_MODE_RDONLY,
+    write = MPI_MODE_WRONLY | MPI_MODE_CREATE,
+    read_write = MPI_MODE_RDWR | MPI_MODE_CREATE
+};
+
+/// Setting of a collective buffering hint
+enum class buffering { automatic, enable, disable };
+
+/// file_hints are passed to the MPI-IO implementation when opening a file.
+/// With collective buffering a subset of processes (the aggregators) gather
+/// the data from the other processes and issue large contiguous requests to
+/// the file system.  A zero value leaves the implementation default in place.
+/// Implementations silently ignore hints they do not understand.
+struct file_hints
+{
+    /// Collective buffering for write operations (romio_cb_write)
+    buffering collective_write = buffering::automatic;
+    /// Collective buffering for read operations (romio_cb_read)
+    buffering collective_read = buffering::automatic;
+    /// Size of the buffer used on each aggregator in bytes (cb_buffer_size)
+    int buffer_size = 0;
+    /// Number of aggregator processes (cb_nodes)
+    int aggregators = 0;
+    /// Number of storage targets a new file is striped over (striping_factor)
+    int striping_factor = 0;
+    /// Stripe size in bytes of a new file (striping_unit)
+    int striping_unit = 0;
+};
+
+namespace detail
+{
+/// Throw if an MPI-IO call did not succeed.  The default error handler for
+/// files returns error codes rather than aborting.
+inline void check_file_error(int const error_code, std::string const& operation)
+{
+    if (error_code == MPI_SUCCESS) return;
+
+    char message[MPI_MAX_ERROR_STRING];
+    int length = 0;
+    MPI_Error_string(error_code, message, &length);
+
+    throw std::runtime_error(operation + ": " + std::string(message, length));
+}
+
+inline char const* buffering_value(buffering const setting)
+{
+    return setting == buffering::enable ? "enable"
+                                        : setting == buffering::disable ? "disable" : "automatic";
+}
+
+/// \return An info object holding \p hints that the caller must free
+inline MPI_Info make_file_info(file_hints const& hints)
+{
+    MPI_Info info;
+    MPI_Info_create(&info);
+
+    MPI_Info_set(info, "romio_cb_write", buffering_value(hints.collective_write));
+    MPI_Info_set(info, "romio_cb_read", buffering_value(hints.collective_read));
+
+    std::pair<char const*, int> const sizes[] = {{"cb_buffer_size", hints.buffer_size},
+                                                 {"cb_nodes", hints.aggregators},
+                                                 {"striping_factor", hints.striping_factor},
+                                                 {"striping_unit", hints.striping_unit}};
+    for (auto const& size : sizes)
+    {
+        if (size.second > 0)
+        {
+            MPI_Info_set(info, size.first, std::to_string(size.second).c_str());
+        }
+    }
+    return info;
+}
+}
+
+/// file is a handle to a file opened collectively by every process in a
+/// communicator.  It is closed when the object goes out of scope.
+///
+/// Offsets passed to the \p _at_all functions are in bytes from the start of
+/// the file, so a process writing the block of a distributed vector starting
+/// at global index \p first uses an offset of first * sizeof(value_type).
+/// The layout functions taking a derived_type describe the part of the file
+/// (for example a subarray of a global grid) this process accesses.
+///
+/// All functions are collective over the communicator the file was opened on.
+/// The buffer of a nonblocking operation must stay alive and unmodified until
+/// the request has completed, and all requests must complete before the next
+/// operation that changes the layout or before the file is closed.
+///
+/// Data written by one process is only guaranteed to be visible to reads from
+/// another process through the same file object after sync(), barrier() and
+/// sync() again, or after the file has been closed and reopened.
+class file
+{
+public:
+    /// Collectively open \p filename
+    /// \param filename Path of the file, identical on all processes
+    /// \param mode Access mode \sa file_mode
+    /// \param hints Hints for the MPI-IO implementation \sa file_hints
+    /// \param comm MPI communicator
+    file(std::string const& filename,
+         file_mode const mode,
+         file_hints const& hints = file_hints{},
+         communicator const comm = communicator::world)
+    {
+        MPI_Info info = detail::make_file_info(hints);
+
+        auto const error_code = MPI_File_open(comm == communicator::world ? MPI_COMM_WORLD
+                                                                          : MPI_COMM_SELF,
+                                              const_cast<char*>(filename.c_str()),
+                                              static_cast<int>(mode),
+                                              info,
+                                              &handle);
+        MPI_Info_free(&info);
+
+        detail::check_file_error(error_code, "mpi::file could not open " + filename);
+
+        if (mode == file_mode::write)
+        {
+            // Discard the old contents so a shorter file leaves no stale bytes
+            auto const truncate_code = MPI_File_set_size(handle, 0);
+            if (truncate_code != MPI_SUCCESS) MPI_File_close(&handle);
+
+            detail::check_file_error(truncate_code, "mpi::file could not truncate " + filename);
+        }
+    }
+
+    file(file&& other) noexcept : handle(other.handle), is_byte_view(other.is_byte_view)
+    {
+        other.handle = MPI_FILE_NULL;
+    }
+
+    file& operator=(file&& other) noexcept
+    {
+        std::swap(handle, other.handle);
+        std::swap(is_byte_view, other.is_byte_view);
+        return *this;
+    }
+
+    file(file const&) = delete;
+    file& operator=(file const&) = delete;
+
+    ~file()
+    {
+        if (handle != MPI_FILE_NULL) MPI_File_close(&handle);
+    }
+
+    /// Collectively close the file before the object goes out of scope
+    void close()
+    {
+        if (handle != MPI_FILE_NULL)
+        {
+            detail::check_file_error(MPI_File_close(&handle), "mpi::file::close");
+        }
+    }
+
+    /// \return The size of the file in bytes
+    MPI_Offset size() const
+    {
+        MPI_Offset file_size;
+        detail::check_file_error(MPI_File_get_size(handle, &file_size), "mpi::file::size");
+        return file_size;
+    }
+
+    /// Collectively resize the file to \p file_size bytes
+    void resize(MPI_Offset const file_size)
+    {
+        detail::check_file_error(MPI_File_set_size(handle, file_size), "mpi::file::resize");
+    }
+
+    /// Collectively flush the written data to the storage device
+    void sync() { detail::check_file_error(MPI_File_sync(handle), "mpi::file::sync"); }
+
+    /// Collectively write a contiguous vector starting \p offset bytes into the file
+    template <typename T>
+    auto write_at_all(MPI_Offset const offset, T const& data)
+        -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value>
+    {
+        write_at_all(offset, data, data_type<typename T::value_type>::value_type());
+    }
+
+    /// Collectively write a vector of structures described by \p element_type.
+    /// Structures are stored in the file without padding, so the offset of
+    /// the n-th structure is n * element_type.size() bytes.
+    /// \sa make_struct()
+    template <typename T>
+    void write_at_all(MPI_Offset const offset, T const& data, derived_type const& element_type)
+    {
+        write_at_all(offset, data, element_type.value_type());
+    }
+
+    /// Collectively read \p count values starting \p offset bytes into the file
+    template <typename T>
+    auto read_at_all(MPI_Offset const offset, std::size_t const count)
+        -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value, T>
+    {
+        return read_at_all<T>(offset, count, data_type<typename T::value_type>::value_type());
+    }
+
+    /// Collectively read \p count structures described by \p element_type
+    template <typename T>
+    T read_at_all(MPI_Offset const offset,
+                  std::size_t const count,
+                  derived_type const& element_type)
+    {
+        return read_at_all<T>(offset, count, element_type.value_type());
+    }
+
+    /// Start a nonblocking collective write of a contiguous vector starting
+    /// \p offset bytes into the file
+    /// \return An MPI request object \sa wait()
+    template <typename T>
+    auto iwrite_at_all(MPI_Offset const offset, T const& data)
+        -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value, request>
+    {
+        using value_type = typename T::value_type;
+
+        use_byte_view();
+
+        request write_request;
+
+        detail::check_file_error(MPI_File_iwrite_at_all(handle,
+                                                        offset,
+                                                        const_cast<value_type*>(data.data()),
+                                                        data.size(),
+                                                        data_type<value_type>::value_type(),
+                                                        &write_request),
+                                 "mpi::file::iwrite_at_all");
+        return write_request;
+    }
+
+    /// Collectively write the local block of a distributed array.  The
+    /// \p layout is created with make_subarray() and selects the entries of the
+    /// global array (stored from \p displacement bytes into the file) that this
+    /// process owns.  \p data holds these entries contiguously.
+    template <typename T>
+    auto write_all(derived_type const& layout, T const& data, MPI_Offset const displacement = 0)
+        -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value>
+    {
+        using value_type = typename T::value_type;
+
+        auto const element_type = data_type<value_type>::value_type();
+
+        set_view(displacement, element_type, layout.value_type());
+
+        detail::check_file_error(MPI_File_write_all(handle,
+                                                    const_cast<value_type*>(data.data()),
+                                                    data.size(),
+                                                    element_type,
+                                                    MPI_STATUS_IGNORE),
+                                 "mpi::file::write_all");
+    }
+
+    /// Collectively read the local block of a distributed array
+    /// \sa write_all(derived_type const&, T const&, MPI_Offset)
+    /// \param layout Subarray selecting the local block
+    /// \param count Number of entries in the local block
+    /// \param displacement Start of the global array in bytes
+    template <typename T>
+    auto read_all(derived_type const& layout,
+                  std::size_t const count,
+                  MPI_Offset const displacement = 0)
+        -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value, T>
+    {
+        auto const element_type = data_type<typename T::value_type>::value_type();
+
+        set_view(displacement, element_type, layout.value_type());
+
+        T data(count);
+
+        detail::check_file_error(MPI_File_read_all(handle,
+                                                   data.data(),
+                                                   data.size(),
+                                                   element_type,
+                                                   MPI_STATUS_IGNORE),
+                                 "mpi::file::read_all");
+        return data;
+    }
+
+    /// Start a nonblocking collective write of the local block of a
+    /// distributed array \sa write_all(derived_type const&, T const&, MPI_Offset)
+    /// \return An MPI request object \sa wait()
+    template <typename T>
+    auto iwrite_all(derived_type const& layout, T const& data, MPI_Offset const displacement = 0)
+        -> std::enable_if_t<detail::has_data_type<typename T::value_type>::value, request>
+    {
+        auto const element_type = data_type<typename T::value_type>::value_type();
+
+        set_view(displacement, element_type, layout.value_type());
+
+        request write_request;
+
+        detail::check_file_error(MPI_File_iwrite_all(handle,
+                                                     const_cast<typename T::value_type*>(
+                                                         data.data()),
+                                                     data.size(),
+                                                     element_type,
+                                                     &write_request),
+                                 "mpi::file::iwrite_all");
+        return write_request;
+    }
+
+private:
+    template <typename T>
+    void write_at_all(MPI_Offset const offset, T const& data, MPI_Datatype const element_type)
+    {
+        use_byte_view();
+
+        detail::check_file_error(MPI_File_write_at_all(handle,
+                                                       offset,
+                                                       const_cast<typename T::value_type*>(
+                                                           data.data()),
+                                                       data.size(),
+                                                       element_type,
+                                                       MPI_STATUS_IGNORE),
+                                 "mpi::file::write_at_all");
+    }
+
+    template <typename T>
+    T read_at_all(MPI_Offset const offset, std::size_t const count, MPI_Datatype const element_type)
+    {
+        use_byte_view();
+
+        T data(count);
+
+        detail::check_file_error(MPI_File_read_at_all(handle,
+                                                      offset,
+                                                      data.data(),
+                                                      data.size(),
+                                                      element_type,
+                                                      MPI_STATUS_IGNORE),
+                                 "mpi::file::read_at_all");
+        return data;
+    }
+
+    void set_view(MPI_Offset const displacement,
+                  MPI_Datatype const element_type,
+                  MPI_Datatype const file_type)
+    {
+        detail::check_file_error(MPI_File_set_view(handle,
+                                                   displacement,
+                                                   element_type,
+                                                   file_type,
+                                                   const_cast<char*>("native"),
+                                                   MPI_INFO_NULL),
+                                 "mpi::file::set_view");
+        is_byte_view = false;
+    }
+
+    /// Restore the default view where offsets are counted in bytes
+    void use_byte_view()
+    {
+        if (is_byte_view) return;
+
+        set_view(0, MPI_BYTE, MPI_BYTE);
+
+        is_byte_view = true;
+    }
+
+private:
+    MPI_File handle = MPI_FILE_NULL;
+
+    /// Offsets of the _at_all operations are in bytes from the start of the file
+    bool is_byte_view = true;
+};
+
+/// Delete the file \p filename.  This is not collective and should be called
+/// by a single process after the file has been closed.
+inline void remove_file(std::string const& filename)
+{
+    detail::check_file_error(MPI_File_delete(const_cast<char*>(filename.c_str()), MPI_INFO_NULL),
+                             "mpi::remove_file");
+}
+}
@@ -0,0 +1,185 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+/// \file halo.hpp
+/// \brief Halo exchange overlapping the messages with the interior work
+
+namespace mpi
+{
+namespace detail
+{
+/// Boundary region shared with a neighbouring process
+struct halo_region
+{
+    /// Post the receive of the neighbour's halo
+    std::function<request()> receive;
+    /// Post the send of the local halo to the neighbour
+    std::function<request()> send;
+    /// Update the cells that depend on the received halo
+    std::function<void()> kernel;
+};
+}
+
+/// Time in seconds spent in each phase of the exchanges since the last reset
+struct halo_timings
+{
+    /// Posting the receives and sends
+    double post = 0.0;
+    /// Running the interior kernel while the messages are in flight
+    double interior = 0.0;
+    /// Waiting for halos that had not arrived once there was no other work
+    double receive_wait = 0.0;
+    /// Running the boundary kernels
+    double boundary = 0.0;
+    /// Waiting for the sends to complete
+    double send_wait = 0.0;
+
+    /// The number of exchanges timed
+    std::size_t exchanges = 0;
+};
+
+/// halo_exchange runs one step of a domain decomposed computation so that
+/// the messages between neighbours overlap with the work that does not need
+/// them.  Each boundary region is described by a neighbour, the buffers sent
+/// to and received from it and a kernel updating the cells that depend on
+/// the received halo.  exchange() posts every receive and send without
+/// blocking, runs the interior kernel and then runs the kernel of each
+/// region as soon as its halo arrives, in the order the messages complete.
+///
+/// The buffers are held by reference and must stay alive, with the outgoing
+/// halos filled before each exchange.  A region with the neighbour
+/// \p MPI_PROC_NULL, such as a physical boundary, completes at once and its
+/// kernel is still run.
+class halo_exchange
+{
+public:
+    explicit halo_exchange(communicator const comm = communicator::world) : comm(comm) {}
+
+    /// Add a boundary region shared with \p neighbour
+    /// \param outgoing Halo sent to the neighbour, a built-in value or a
+    ///                 contiguous vector of built-in types
+    /// \param incoming Halo received from the neighbour, sized to the message
+    /// \param boundary_kernel Called once the halo has arrived
+    /// \param send_tag Tag of the outgoing halo
+    /// \param receive_tag Tag of the incoming halo, the send_tag of the
+    ///                    matching region on the neighbour
+    template <typename T, typename Kernel_Tp>
+    void add_region(int const neighbour,
+                    T const& outgoing,
+                    T& incoming,
+                    Kernel_Tp&& boundary_kernel,
+                    int const send_tag = 0,
+                    int const receive_tag = 0)
+    {
+        auto const region_comm = comm;
+
+        detail::halo_region region;
+
+        region.receive = [&incoming, neighbour, receive_tag, region_comm] {
+            return mpi::receive(async{}, incoming, neighbour, receive_tag, region_comm);
+        };
+        region.send = [&outgoing, neighbour, send_tag, region_comm] {
+            return mpi::send(async{}, outgoing, neighbour, send_tag, region_comm);
+        };
+        region.kernel = std::forward<Kernel_Tp>(boundary_kernel);
+
+        regions.push_back(std::move(region));
+    }
+
+    /// The outgoing halo is sent in every exchange, so a temporary would be
+    /// destroyed before it is read
+    template <typename T, typename Kernel_Tp>
+    void add_region(int const neighbour,
+                    T const&& outgoing,
+                    T& incoming,
+                    Kernel_Tp&& boundary_kernel,
+                    int const send_tag = 0,
+                    int const receive_tag = 0) = delete;
+
+    /// Exchange the halos of every region and update the domain
+    /// \param interior_kernel Updates the cells that do not depend on a halo
+    template <typename Kernel_Tp>
+    void exchange(Kernel_Tp&& interior_kernel)
+    {
+        auto start = MPI_Wtime();
+
+        receives.clear();
+        sends.clear();
+
+        // Receives first, so the halos of fast neighbours have somewhere to go
+        for (auto const& region : regions) receives.push_back(region.receive());
+        for (auto const& region : regions) sends.push_back(region.send());
+
+        lap(timings.post, start);
+
+        try
+        {
+            interior_kernel();
+        }
+        catch (...)
+        {
+            // The buffers may not be released with messages still in flight
+            wait_all(receives);
+            wait_all(sends);
+            throw;
+        }
+        lap(timings.interior, start);
+
+        for (int index = wait_any(receives); index >= 0; index = wait_any(receives))
+        {
+            lap(timings.receive_wait, start);
+
+            try
+            {
+                regions[index].kernel();
+            }
+            catch (...)
+            {
+                // The halos still to arrive and the sends are in flight
+                wait_all(receives);
+                wait_all(sends);
+                throw;
+            }
+            lap(timings.boundary, start);
+        }
+
+        wait_all(sends);
+
+        lap(timings.send_wait, start);
+
+        ++timings.exchanges;
+    }
+
+    /// \return The number of boundary regions
+    std::size_t size() const { return regions.size(); }
+
+    /// \return The time spent in each phase of the exchanges
+    halo_timings const& timers() const { return timings; }
+
+    void reset_timers() { timings = halo_timings{}; }
+
+private:
+    /// Add the time since \p start to \p phase and restart the clock
+    static void lap(double& phase, double& start)
+    {
+        auto const now = MPI_Wtime();
+        phase += now - start;
+        start = now;
+    }
+
+private:
+    communicator comm;
+
+    std::vector<detail::halo_region> regions;
+
+    std::vector<request> receives, sends;
+
+    halo_timings timings;
+};
+}
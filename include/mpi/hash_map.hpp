@@ -0,0 +1,830 @@
+
+#pragma once
+
+#include "mpi.hpp"
+#include "mpi/window.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/// \file hash_map.hpp
+/// \brief Hash map distributed over the processes of a communicator
+
+namespace mpi
+{
+/// Result of a lookup in a distributed_hash_map
+template <typename Value_Tp>
+struct lookup
+{
+    bool found;
+    Value_Tp value;
+};
+
+namespace detail
+{
+/// Scramble the bits of a hash so that both the owner (low bits) and the slot
+/// (high bits) are well distributed, even for the identity hash of integers
+inline std::uint64_t mix_hash(std::uint64_t hash)
+{
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+constexpr std::size_t round_up(std::size_t const size, std::size_t const alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+}
+
+/// distributed_hash_map partitions its keys over the processes of a
+/// communicator by hash and stores the entries of each process in a fixed
+/// size open addressing table.  Keys are only ever added, so it suits
+/// deduplication and global lookup tables.
+///
+/// Values up to one_sided_value_limit bytes are stored in a window and every
+/// operation is done with one-sided communication.  A slot is claimed with
+/// compare_and_swap(), filled with put() and then marked as full, while
+/// lookups read the slot state before the key and value.  The owner does not
+/// take part.  Operations are issued in batches, with all of the operations
+/// of one probing step started together and completed by a single flush.
+///
+/// Larger values are sent in one aggregated message per owner and the owner
+/// replies with one message.  The requests are answered by a service thread
+/// of the map, so the owner does not take part either and no process has to
+/// wait for the others.  This needs \p MPI_THREAD_MULTIPLE, without which
+/// large values are stored in the window as well.
+///
+/// Construction and destruction are collective.  insert() and find() are not,
+/// and an entry inserted by one process can be found by every other process
+/// as soon as the insert() has returned.  With the async tag they return a
+/// batch handle instead, so the caller can compute while the operations are
+/// in flight and collect the results with wait().  The operations of one map
+/// must not be called from several threads at once.
+/// \tparam Key_Tp Trivially copyable key
+/// \tparam Value_Tp Trivially copyable value
+template <typename Key_Tp,
+          typename Value_Tp,
+          typename Hash = std::hash<Key_Tp>,
+          typename KeyEqual = std::equal_to<Key_Tp>>
+class distributed_hash_map
+{
+    static_assert(std::is_trivially_copyable<Key_Tp>::value
+                      && std::is_trivially_copyable<Value_Tp>::value,
+                  "mpi::distributed_hash_map requires trivially copyable keys and values");
+
+public:
+    /// Values larger than this are inserted and found with messages when MPI
+    /// provides thread::multiple
+    static constexpr std::size_t one_sided_value_limit = 256;
+
+public:
+    /// \param capacity Maximum number of entries stored on each process
+    /// \param comm MPI communicator
+    explicit distributed_hash_map(std::size_t const capacity,
+                                  communicator const comm = communicator::world,
+                                  Hash hash = Hash{},
+                                  KeyEqual key_equal = KeyEqual{})
+        : comm(comm),
+          capacity(std::max<std::size_t>(capacity, 1)),
+          processes(mpi::size(comm)),
+          process(mpi::rank(comm)),
+          one_sided(sizeof(Value_Tp) <= one_sided_value_limit
+                    || thread_level() != thread::multiple),
+          slots(one_sided ? this->capacity * slot_size : 0, comm),
+          hash(hash),
+          key_equal(key_equal),
+          local_entries(one_sided ? 0 : this->capacity, hash, key_equal)
+    {
+        if (one_sided)
+        {
+            std::memset(slots.data(), 0, this->capacity * slot_size);
+            slots.sync();
+        }
+        else
+        {
+            auto const handle = comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF;
+
+            MPI_Comm_dup(handle, &request_communicator);
+            MPI_Comm_dup(handle, &reply_communicator);
+
+            service = std::thread([this] { serve(); });
+        }
+        barrier(comm);
+    }
+
+    distributed_hash_map(distributed_hash_map const&) = delete;
+    distributed_hash_map& operator=(distributed_hash_map const&) = delete;
+
+    ~distributed_hash_map()
+    {
+        if (one_sided) return;
+
+        // Once every process is here no more requests are on their way
+        MPI_Barrier(reply_communicator);
+
+        MPI_Send(nullptr, 0, MPI_BYTE, process, stop_tag, request_communicator);
+        service.join();
+
+        MPI_Comm_free(&request_communicator);
+        MPI_Comm_free(&reply_communicator);
+    }
+
+    /// \return true if the entries are stored in a window and accessed with
+    ///         one-sided operations
+    bool is_one_sided() const { return one_sided; }
+
+private:
+    struct batch_state;
+
+public:
+    /// batch is the handle of insertions or lookups started with the async
+    /// tag.  The first probing step, or the requests to the owners, are
+    /// started with the batch and the remaining steps are done by wait().  A
+    /// handle destroyed before wait() completes the batch and discards the
+    /// result, including the std::runtime_error of an insertion that found no
+    /// free slot, so call wait() to learn whether every insertion succeeded.
+    /// Every batch must be completed before the map is destroyed.
+    /// \tparam Result_Tp Result of each key returned by wait()
+    template <typename Result_Tp>
+    class batch
+    {
+    public:
+        batch(batch&&) = default;
+        batch& operator=(batch&&) = delete;
+
+        /// Completes a batch that was not waited on, ignoring its errors
+        ~batch()
+        {
+            if (!state) return;
+            try
+            {
+                map->finish(*state);
+            }
+            catch (std::runtime_error const&)
+            {
+            }
+        }
+
+        /// Complete the batch.  An insertion that finds no free slot on the
+        /// owner throws std::runtime_error, as does calling wait() again or on
+        /// a batch that has been moved from.
+        /// \return The result for each key, in the order of the keys
+        std::vector<Result_Tp> wait()
+        {
+            if (!state)
+            {
+                throw std::runtime_error("mpi::distributed_hash_map::batch::wait: the batch "
+                                         "has already been completed");
+            }
+            auto const finished = std::move(state);
+            map->finish(*finished);
+            return results_of(*finished, Result_Tp{});
+        }
+
+    private:
+        friend class distributed_hash_map;
+
+        batch(distributed_hash_map* map, std::unique_ptr<batch_state> state)
+            : map(map), state(std::move(state))
+        {
+        }
+
+        static std::vector<bool> results_of(batch_state& finished, bool)
+        {
+            return std::move(finished.succeeded);
+        }
+
+        static std::vector<lookup<Value_Tp>> results_of(batch_state& finished, lookup<Value_Tp>)
+        {
+            return std::move(finished.results);
+        }
+
+    private:
+        distributed_hash_map* map;
+        std::unique_ptr<batch_state> state;
+    };
+
+    using insert_batch = batch<bool>;
+    using find_batch = batch<lookup<Value_Tp>>;
+
+public:
+    /// Insert the entries keys[i], values[i] whose key is not already present
+    /// \return For each key, true if it was inserted and false if it was present
+    std::vector<bool> insert(std::vector<Key_Tp> const& keys, std::vector<Value_Tp> const& values)
+    {
+        return insert(async{}, keys, values).wait();
+    }
+
+    /// \return true if \p key was inserted and false if it was already present
+    bool insert(Key_Tp const& key, Value_Tp const& value)
+    {
+        return insert(std::vector<Key_Tp>{key}, std::vector<Value_Tp>{value}).front();
+    }
+
+    /// Start inserting the entries keys[i], values[i] whose key is not
+    /// already present.  The keys and values are copied into the batch.
+    /// \return Handle whose wait() returns for each key whether it was inserted
+    insert_batch insert(async, std::vector<Key_Tp> keys, std::vector<Value_Tp> values)
+    {
+        auto state = make_state(insert_tag, std::move(keys));
+        state->values = std::move(values);
+
+        if (one_sided)
+        {
+            start_insert_one_sided(*state);
+        }
+        else
+        {
+            start_exchange(*state);
+        }
+        return insert_batch(this, std::move(state));
+    }
+
+    /// \return For each key, whether it was found and its value
+    std::vector<lookup<Value_Tp>> find(std::vector<Key_Tp> const& keys)
+    {
+        return find(async{}, keys).wait();
+    }
+
+    lookup<Value_Tp> find(Key_Tp const& key) { return find(std::vector<Key_Tp>{key}).front(); }
+
+    /// Start looking up \p keys.  The keys are copied into the batch.
+    /// \return Handle whose wait() returns for each key whether it was found
+    ///         and its value
+    find_batch find(async, std::vector<Key_Tp> keys)
+    {
+        auto state = make_state(find_tag, std::move(keys));
+
+        if (one_sided)
+        {
+            start_find_one_sided(*state);
+        }
+        else
+        {
+            start_exchange(*state);
+        }
+        return find_batch(this, std::move(state));
+    }
+
+private:
+    /// State of a slot in the one-sided table
+    static constexpr long long empty = 0, claimed = 1, full = 2;
+
+    /// Layout of a slot in bytes
+    static constexpr std::size_t key_offset = detail::round_up(sizeof(long long),
+                                                               alignof(Key_Tp));
+    static constexpr std::size_t value_offset = detail::round_up(key_offset + sizeof(Key_Tp),
+                                                                 alignof(Value_Tp));
+    static constexpr std::size_t slot_size = detail::round_up(value_offset + sizeof(Value_Tp),
+                                                              alignof(long long));
+
+    /// Requests are sent with these tags and the replies with the same tag
+    static constexpr int insert_tag = 1, find_tag = 2, stop_tag = 3;
+
+    struct outgoing_message
+    {
+        std::vector<char> buffer;
+        request send_request;
+    };
+
+    struct incoming_reply
+    {
+        int owner;
+        std::vector<char> buffer;
+        request receive_request;
+    };
+
+    /// Position of an operation in the one-sided table
+    struct probe
+    {
+        std::size_t index;
+        int owner;
+        std::size_t slot;
+    };
+
+    /// Operations and results of a batch.  The one-sided operations and the
+    /// messages in flight read from and write into it, so it stays in place
+    /// until the batch is complete.
+    struct batch_state
+    {
+        int tag;
+
+        std::vector<Key_Tp> keys;
+        std::vector<Value_Tp> values;
+
+        std::vector<bool> succeeded;
+        std::vector<lookup<Value_Tp>> results;
+
+        /// Probes of the one-sided table
+        std::vector<probe> pending, next, claims, comparisons;
+        std::vector<std::size_t> probe_counts;
+        std::vector<long long> states;
+        std::vector<Key_Tp> stored_keys;
+
+        /// Messages to and from the owners, with the indices of the keys of each owner
+        std::vector<std::vector<std::size_t>> indices;
+        std::vector<outgoing_message> requests;
+        std::vector<incoming_reply> replies;
+    };
+
+private:
+    std::uint64_t hash_of(Key_Tp const& key) const { return detail::mix_hash(hash(key)); }
+
+    int owner_of(Key_Tp const& key) const { return hash_of(key) % processes; }
+
+    probe first_probe(std::size_t const index, Key_Tp const& key) const
+    {
+        auto const key_hash = hash_of(key);
+        return {index, static_cast<int>(key_hash % processes), key_hash / processes % capacity};
+    }
+
+    MPI_Aint slot_displacement(probe const& position, std::size_t const offset = 0) const
+    {
+        return position.slot * slot_size + offset;
+    }
+
+    /// Move to the next slot
+    /// \return false once every slot of the owner has been visited
+    bool advance(probe& position, std::size_t& probe_count) const
+    {
+        position.slot = (position.slot + 1) % capacity;
+        return ++probe_count < capacity;
+    }
+
+    std::unique_ptr<batch_state> make_state(int const tag, std::vector<Key_Tp> keys) const
+    {
+        auto state = std::make_unique<batch_state>();
+
+        state->tag = tag;
+        state->keys = std::move(keys);
+        state->succeeded.resize(state->keys.size());
+
+        if (tag == find_tag) state->results.resize(state->keys.size());
+
+        return state;
+    }
+
+    /// Complete the remaining steps of a batch
+    void finish(batch_state& state)
+    {
+        if (!one_sided)
+        {
+            finish_exchange(state);
+        }
+        else if (state.tag == insert_tag)
+        {
+            finish_insert_one_sided(state);
+        }
+        else
+        {
+            finish_find_one_sided(state);
+        }
+    }
+
+    /// Start claiming the slot of every pending insertion
+    void claim_pending(batch_state& state)
+    {
+        for (auto const& position : state.pending)
+        {
+            slots.compare_and_swap(claimed,
+                                   empty,
+                                   state.states[position.index],
+                                   position.owner,
+                                   slot_displacement(position));
+        }
+    }
+
+    void start_insert_one_sided(batch_state& state)
+    {
+        state.probe_counts.assign(state.keys.size(), 0);
+        state.states.resize(state.keys.size());
+        state.stored_keys.resize(state.keys.size());
+
+        for (std::size_t index = 0; index < state.keys.size(); ++index)
+        {
+            state.pending.push_back(first_probe(index, state.keys[index]));
+        }
+        claim_pending(state);
+    }
+
+    void finish_insert_one_sided(batch_state& state)
+    {
+        auto const& keys = state.keys;
+        auto const& values = state.values;
+        auto& inserted = state.succeeded;
+
+        auto& previous_states = state.states;
+        auto& stored_keys = state.stored_keys;
+
+        auto& pending = state.pending;
+        auto& next = state.next;
+        auto& claims = state.claims;
+        auto& comparisons = state.comparisons;
+
+        while (!pending.empty())
+        {
+            slots.flush_all();
+
+            next.clear();
+            claims.clear();
+            comparisons.clear();
+
+            for (auto const& position : pending)
+            {
+                auto const index = position.index;
+
+                if (previous_states[index] == empty)
+                {
+                    slots.put(&keys[index],
+                              sizeof(Key_Tp),
+                              position.owner,
+                              slot_displacement(position, key_offset));
+                    slots.put(&values[index],
+                              sizeof(Value_Tp),
+                              position.owner,
+                              slot_displacement(position, value_offset));
+                    claims.push_back(position);
+                }
+                else if (previous_states[index] == full)
+                {
+                    slots.get(&stored_keys[index],
+                              sizeof(Key_Tp),
+                              position.owner,
+                              slot_displacement(position, key_offset));
+                    comparisons.push_back(position);
+                }
+                else
+                {
+                    // Another process is filling the slot, so look again
+                    next.push_back(position);
+                }
+            }
+            slots.flush_all();
+
+            for (auto const& position : claims)
+            {
+                slots.accumulate(full, position.owner, slot_displacement(position), replace{});
+                inserted[position.index] = true;
+            }
+
+            int full_owner = -1;
+
+            for (auto position : comparisons)
+            {
+                if (key_equal(stored_keys[position.index], keys[position.index]))
+                {
+                    inserted[position.index] = false;
+                }
+                else if (advance(position, state.probe_counts[position.index]))
+                {
+                    next.push_back(position);
+                }
+                else
+                {
+                    full_owner = position.owner;
+                }
+            }
+            // Complete the claimed slots of this step before giving up
+            slots.flush_all();
+
+            if (full_owner >= 0)
+            {
+                pending.clear();
+
+                throw std::runtime_error("mpi::distributed_hash_map is full on process "
+                                         + std::to_string(full_owner));
+            }
+
+            std::swap(pending, next);
+
+            claim_pending(state);
+        }
+    }
+
+    /// Start reading the slot state of every pending lookup
+    void load_pending(batch_state& state)
+    {
+        for (auto const& position : state.pending)
+        {
+            slots.load(state.states[position.index], position.owner, slot_displacement(position));
+        }
+    }
+
+    void start_find_one_sided(batch_state& state)
+    {
+        state.probe_counts.assign(state.keys.size(), 0);
+        state.states.resize(state.keys.size());
+        state.stored_keys.resize(state.keys.size());
+
+        for (std::size_t index = 0; index < state.keys.size(); ++index)
+        {
+            state.pending.push_back(first_probe(index, state.keys[index]));
+        }
+        load_pending(state);
+    }
+
+    void finish_find_one_sided(batch_state& state)
+    {
+        auto const& keys = state.keys;
+        auto& results = state.results;
+
+        auto& states = state.states;
+        auto& stored_keys = state.stored_keys;
+
+        auto& pending = state.pending;
+        auto& next = state.next;
+        auto& occupied = state.comparisons;
+
+        while (!pending.empty())
+        {
+            slots.flush_all();
+
+            next.clear();
+            occupied.clear();
+
+            // The key and value of a slot are only read once it is known to be full
+            for (auto const& position : pending)
+            {
+                auto const index = position.index;
+
+                if (states[index] == empty)
+                {
+                    results[index].found = false;
+                }
+                else if (states[index] == full)
+                {
+                    slots.get(&stored_keys[index],
+                              sizeof(Key_Tp),
+                              position.owner,
+                              slot_displacement(position, key_offset));
+                    slots.get(&results[index].value,
+                              sizeof(Value_Tp),
+                              position.owner,
+                              slot_displacement(position, value_offset));
+                    occupied.push_back(position);
+                }
+                else
+                {
+                    next.push_back(position);
+                }
+            }
+            slots.flush_all();
+
+            for (auto position : occupied)
+            {
+                if (key_equal(stored_keys[position.index], keys[position.index]))
+                {
+                    results[position.index].found = true;
+                }
+                else if (advance(position, state.probe_counts[position.index]))
+                {
+                    next.push_back(position);
+                }
+                else
+                {
+                    results[position.index].found = false;
+                }
+            }
+            std::swap(pending, next);
+
+            load_pending(state);
+        }
+    }
+
+    /// Apply an insertion or lookup to the entries stored on this process
+    bool apply_local(int const tag, Key_Tp const& key, char const* value, char* found_value)
+    {
+        std::lock_guard<std::mutex> lock(entries_mutex);
+
+        if (tag == insert_tag)
+        {
+            Value_Tp new_value;
+            std::memcpy(&new_value, value, sizeof(Value_Tp));
+            return local_entries.emplace(key, new_value).second;
+        }
+
+        auto const entry = local_entries.find(key);
+        if (entry == local_entries.end()) return false;
+
+        std::memcpy(found_value, &entry->second, sizeof(Value_Tp));
+        return true;
+    }
+
+    /// Send one request per owner holding the keys (and values to insert),
+    /// post the receives of the replies and apply the local operations.  A
+    /// reply holds one byte per key followed for lookups by the values.
+    void start_exchange(batch_state& state)
+    {
+        auto const tag = state.tag;
+        auto const& keys = state.keys;
+
+        auto const entry_size = sizeof(Key_Tp) + (tag == insert_tag ? sizeof(Value_Tp) : 0);
+
+        auto& indices = state.indices;
+        indices.resize(processes);
+
+        for (std::size_t index = 0; index < keys.size(); ++index)
+        {
+            indices[owner_of(keys[index])].push_back(index);
+        }
+
+        // The requests are written to by MPI, so they must not be reallocated
+        state.requests.reserve(processes);
+        state.replies.reserve(processes);
+
+        for (int owner = 0; owner < processes; ++owner)
+        {
+            if (owner == process || indices[owner].empty()) continue;
+
+            auto const count = indices[owner].size();
+
+            state.requests.push_back({std::vector<char>(count * entry_size), MPI_REQUEST_NULL});
+
+            auto& outgoing = state.requests.back();
+
+            auto* entry = outgoing.buffer.data();
+            for (auto const index : indices[owner])
+            {
+                std::memcpy(entry, &keys[index], sizeof(Key_Tp));
+                if (tag == insert_tag)
+                {
+                    std::memcpy(entry + sizeof(Key_Tp), &state.values[index], sizeof(Value_Tp));
+                }
+                entry += entry_size;
+            }
+
+            MPI_Isend(outgoing.buffer.data(),
+                      outgoing.buffer.size(),
+                      MPI_BYTE,
+                      owner,
+                      tag,
+                      request_communicator,
+                      &outgoing.send_request);
+
+            // The owner answers its requests in order, so the replies of
+            // several batches match the receives in the order they were posted
+            state.replies.push_back(
+                {owner,
+                 std::vector<char>(count + (tag == find_tag ? count * sizeof(Value_Tp) : 0)),
+                 MPI_REQUEST_NULL});
+
+            auto& incoming = state.replies.back();
+
+            MPI_Irecv(incoming.buffer.data(),
+                      incoming.buffer.size(),
+                      MPI_BYTE,
+                      owner,
+                      tag,
+                      reply_communicator,
+                      &incoming.receive_request);
+        }
+
+        for (auto const index : indices[process])
+        {
+            auto const* value = tag == insert_tag ? &state.values[index] : nullptr;
+            auto* found_value = tag == find_tag ? &state.results[index].value : nullptr;
+
+            state.succeeded[index] = apply_local(tag,
+                                                 keys[index],
+                                                 reinterpret_cast<char const*>(value),
+                                                 reinterpret_cast<char*>(found_value));
+        }
+    }
+
+    /// Wait for the replies and the requests of a batch
+    void finish_exchange(batch_state& state)
+    {
+        for (auto& incoming : state.replies)
+        {
+            MPI_Wait(&incoming.receive_request, MPI_STATUS_IGNORE);
+
+            auto const& owner_indices = state.indices[incoming.owner];
+            auto const& reply = incoming.buffer;
+
+            for (std::size_t entry = 0; entry < owner_indices.size(); ++entry)
+            {
+                state.succeeded[owner_indices[entry]] = reply[entry] != 0;
+
+                if (state.tag == find_tag && reply[entry])
+                {
+                    std::memcpy(&state.results[owner_indices[entry]].value,
+                                reply.data() + owner_indices.size() + entry * sizeof(Value_Tp),
+                                sizeof(Value_Tp));
+                }
+            }
+        }
+
+        for (auto& outgoing : state.requests) MPI_Wait(&outgoing.send_request, MPI_STATUS_IGNORE);
+
+        if (state.tag == find_tag)
+        {
+            for (std::size_t index = 0; index < state.keys.size(); ++index)
+            {
+                state.results[index].found = state.succeeded[index];
+            }
+        }
+        state.replies.clear();
+        state.requests.clear();
+    }
+
+    /// Answer requests on the service thread until the map is destroyed
+    void serve()
+    {
+        for (;;)
+        {
+            MPI_Status status;
+            MPI_Message message;
+            MPI_Mprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, request_communicator, &message, &status);
+
+            if (status.MPI_TAG == stop_tag)
+            {
+                MPI_Mrecv(nullptr, 0, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+                return;
+            }
+            answer(message, status);
+        }
+    }
+
+    /// Receive the request described by \p status, apply it and reply
+    void answer(MPI_Message& message, MPI_Status const& status)
+    {
+        auto const tag = status.MPI_TAG;
+
+        int bytes = 0;
+        MPI_Get_count(&status, MPI_BYTE, &bytes);
+
+        std::vector<char> request_entries(bytes);
+        MPI_Mrecv(request_entries.data(), bytes, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+
+        auto const entry_size = sizeof(Key_Tp) + (tag == insert_tag ? sizeof(Value_Tp) : 0);
+        auto const entries = request_entries.size() / entry_size;
+
+        std::vector<char> reply(entries + (tag == find_tag ? entries * sizeof(Value_Tp) : 0));
+
+        for (std::size_t entry = 0; entry < entries; ++entry)
+        {
+            auto const* request_entry = request_entries.data() + entry * entry_size;
+
+            Key_Tp key;
+            std::memcpy(&key, request_entry, sizeof(Key_Tp));
+
+            reply[entry] = apply_local(tag,
+                                       key,
+                                       request_entry + sizeof(Key_Tp),
+                                       tag == find_tag
+                                           ? reply.data() + entries + entry * sizeof(Value_Tp)
+                                           : nullptr);
+        }
+
+        // The requesting process is waiting for the reply
+        MPI_Send(reply.data(), reply.size(), MPI_BYTE, status.MPI_SOURCE, tag, reply_communicator);
+    }
+
+private:
+    communicator comm;
+    std::size_t capacity;
+    int processes, process;
+
+    bool one_sided;
+
+    /// Table of slots holding a state, a key and a value for small values
+    window slots;
+
+    Hash hash;
+    KeyEqual key_equal;
+
+    /// Entries stored on this process for large values
+    std::unordered_map<Key_Tp, Value_Tp, Hash, KeyEqual> local_entries;
+    std::mutex entries_mutex;
+
+    /// Private duplicates of the communicator for requests and replies
+    MPI_Comm request_communicator = MPI_COMM_NULL;
+    MPI_Comm reply_communicator = MPI_COMM_NULL;
+
+    /// Thread answering the requests for entries stored on this process
+    std::thread service;
+};
+
+template <typename Key_Tp, typename Value_Tp, typename Hash, typename KeyEqual>
+constexpr std::size_t distributed_hash_map<Key_Tp, Value_Tp, Hash, KeyEqual>::one_sided_value_limit;
+template <typename Key_Tp, typename Value_Tp, typename Hash, typename KeyEqual>
+constexpr long long distributed_hash_map<Key_Tp, Value_Tp, Hash, KeyEqual>::empty;
+template <typename Key_Tp, typename Value_Tp, typename Hash, typename KeyEqual>
+constexpr long long distributed_hash_map<Key_Tp, Value_Tp, Hash, KeyEqual>::claimed;
+template <typename Key_Tp, typename Value_Tp, typename Hash, typename KeyEqual>
+constexpr long long distributed_hash_map<Key_Tp, Value_Tp, Hash, KeyEqual>::full;
+}
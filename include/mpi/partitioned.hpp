@@ -0,0 +1,380 @@
+
+#pragma once
+
+#include "mpi.hpp"
+#include "mpi/threading.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// \file partitioned.hpp
+/// \brief Messages filled and sent in partitions by many threads
+
+namespace mpi
+{
+namespace detail
+{
+/// true if the MPI library provides partitioned communication (MPI 4)
+constexpr bool has_native_partitioned = MPI_VERSION >= 4;
+
+/// State shared by partitioned_send and partitioned_receive.  Natively a
+/// single request covers every partition, otherwise each partition is a
+/// persistent point to point request with its own tag.
+class partitioned_requests
+{
+public:
+    partitioned_requests(partitioned_requests const&) = delete;
+    partitioned_requests& operator=(partitioned_requests const&) = delete;
+
+    /// The transfer must have completed
+    ~partitioned_requests()
+    {
+        for (auto& partition_request : requests)
+        {
+            if (partition_request != MPI_REQUEST_NULL) MPI_Request_free(&partition_request);
+        }
+    }
+
+    int partitions() const { return partition_count; }
+
+    threading_path path() const { return selected_path; }
+
+protected:
+    partitioned_requests(std::size_t const buffer_size,
+                         int const partitions,
+                         threading_path const path)
+        : partition_count(partitions),
+          partition_size(partitions > 0 ? buffer_size / partitions : 0),
+          selected_path(path),
+          creator(std::this_thread::get_id()),
+          flags(new std::atomic<bool>[partitions > 0 ? partitions : 1])
+    {
+        if (partitions <= 0 || buffer_size % partitions != 0)
+        {
+            throw std::runtime_error("mpi::partitioned: the buffer must divide into equal "
+                                     "partitions");
+        }
+        if (path == threading_path::per_thread_communicators && thread_level() != thread::multiple)
+        {
+            throw std::runtime_error("mpi::partitioned: calls from many threads require "
+                                     "thread::multiple");
+        }
+        clear_flags();
+
+        requests.resize(has_native_partitioned ? 1 : partitions, MPI_REQUEST_NULL);
+    }
+
+    void clear_flags()
+    {
+        for (int partition = 0; partition < partition_count; ++partition)
+        {
+            flags[partition].store(false, std::memory_order_relaxed);
+        }
+        flagged.store(0);
+    }
+
+    bool is_creator() const { return std::this_thread::get_id() == creator; }
+
+    /// Tag of a partition when emulated, so partitions that are ready out of
+    /// order still match the right receive
+    int tag_of(int const message_tag, int const partition) const
+    {
+        if (message_tag > (tag_upper_bound() - partition) / partition_count)
+        {
+            throw std::runtime_error("mpi::partitioned: tag " + std::to_string(message_tag)
+                                     + " exceeds MPI_TAG_UB once encoded with the partition");
+        }
+        return message_tag * partition_count + partition;
+    }
+
+protected:
+    int partition_count;
+    std::size_t partition_size;
+
+    threading_path selected_path;
+
+    /// The thread allowed to call MPI on the funnel path
+    std::thread::id creator;
+
+    /// Partitions marked ready by the sender or seen to have arrived
+    std::unique_ptr<std::atomic<bool>[]> flags;
+    std::atomic<int> flagged{0};
+
+    std::vector<request> requests;
+};
+}
+
+/// partitioned_send sends one buffer in equal partitions that are marked
+/// ready independently, typically by the threads that filled them, so each
+/// partition goes on the wire without joining the threads first.  It maps to
+/// \p MPI_Psend_init and \p MPI_Pready with MPI 4 and is otherwise emulated
+/// with a persistent send per partition.  The requests are kept, so the same
+/// buffer can be sent many times with start(), ready() and wait().
+///
+/// With \p MPI_THREAD_MULTIPLE a thread calling ready() starts the transfer
+/// of its partition itself.  Otherwise ready() on another thread only sets a
+/// flag and the partition is sent by the creating thread in ready(),
+/// progress() or wait().  The emulation requires the same number of
+/// partitions on both sides and user tags below tag_upper_bound() /
+/// partitions, and throws for a larger tag.
+/// \tparam T Contiguous vector of values with a data_type
+template <typename T>
+class partitioned_send : public detail::partitioned_requests
+{
+public:
+    /// Select the path from the thread support of MPI \sa select_threading_path
+    partitioned_send(T const& buffer,
+                     int const partitions,
+                     int const destination_process,
+                     int const message_tag = 0,
+                     communicator const comm = communicator::world)
+        : partitioned_send(buffer,
+                           partitions,
+                           destination_process,
+                           message_tag,
+                           select_threading_path(thread_level()),
+                           comm)
+    {
+    }
+
+    partitioned_send(T const& buffer,
+                     int const partitions,
+                     int const destination_process,
+                     int const message_tag,
+                     threading_path const path,
+                     communicator const comm = communicator::world)
+        : partitioned_requests(buffer.size(), partitions, path),
+          is_started(partitions, false)
+    {
+        auto* data = const_cast<typename T::value_type*>(buffer.data());
+        auto const type = data_type<typename T::value_type>::value_type();
+        auto const handle = comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF;
+
+#if MPI_VERSION >= 4
+        MPI_Psend_init(data,
+                       partitions,
+                       partition_size,
+                       type,
+                       destination_process,
+                       message_tag,
+                       handle,
+                       MPI_INFO_NULL,
+                       &requests.front());
+#else
+        for (int partition = 0; partition < partitions; ++partition)
+        {
+            MPI_Send_init(data + partition * partition_size,
+                          partition_size,
+                          type,
+                          destination_process,
+                          tag_of(message_tag, partition),
+                          handle,
+                          &requests[partition]);
+        }
+#endif
+    }
+
+    /// Begin a transfer, after which every partition is marked ready once.
+    /// Called on the creating thread.
+    void start()
+    {
+        clear_flags();
+        std::fill(begin(is_started), end(is_started), false);
+
+#if MPI_VERSION >= 4
+        MPI_Start(&requests.front());
+#endif
+    }
+
+    /// Mark \p partition as filled.  Safe to call from any thread.
+    void ready(int const partition)
+    {
+        if (selected_path == threading_path::per_thread_communicators)
+        {
+            send_partition(partition);
+        }
+        else if (is_creator())
+        {
+            send_partition(partition);
+            is_started[partition] = true;
+        }
+        flags[partition].store(true, std::memory_order_release);
+        ++flagged;
+    }
+
+    /// Send the partitions marked ready by other threads.  Only called on the
+    /// creating thread and does nothing when threads send their own.
+    void progress()
+    {
+        if (selected_path != threading_path::funnel) return;
+
+        for (int partition = 0; partition < partition_count; ++partition)
+        {
+            if (!is_started[partition] && flags[partition].load(std::memory_order_acquire))
+            {
+                send_partition(partition);
+                is_started[partition] = true;
+            }
+        }
+    }
+
+    /// Wait until every partition has been marked ready and sent
+    void wait()
+    {
+        while (flagged.load() < partition_count)
+        {
+            progress();
+            std::this_thread::yield();
+        }
+        progress();
+
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    }
+
+private:
+    void send_partition(int const partition)
+    {
+#if MPI_VERSION >= 4
+        MPI_Pready(partition, requests.front());
+#else
+        MPI_Start(&requests[partition]);
+#endif
+    }
+
+private:
+    /// Partitions sent by the creating thread on the funnel path
+    std::vector<bool> is_started;
+};
+
+/// partitioned_receive receives a buffer sent by a partitioned_send in
+/// partitions, each of which can be used as soon as it has arrived.  It maps
+/// to \p MPI_Precv_init and \p MPI_Parrived with MPI 4 and is otherwise
+/// emulated with a persistent receive per partition.
+///
+/// With \p MPI_THREAD_MULTIPLE any thread may ask whether its partition has
+/// arrived.  Otherwise arrived() on another thread reports what the creating
+/// thread last saw in arrived(), progress() or wait().  wait() must only be
+/// called once no other thread calls arrived().
+/// \tparam T Contiguous vector of values with a data_type
+template <typename T>
+class partitioned_receive : public detail::partitioned_requests
+{
+public:
+    /// Select the path from the thread support of MPI \sa select_threading_path
+    partitioned_receive(T& buffer,
+                        int const partitions,
+                        int const source_process,
+                        int const message_tag = 0,
+                        communicator const comm = communicator::world)
+        : partitioned_receive(buffer,
+                              partitions,
+                              source_process,
+                              message_tag,
+                              select_threading_path(thread_level()),
+                              comm)
+    {
+    }
+
+    partitioned_receive(T& buffer,
+                        int const partitions,
+                        int const source_process,
+                        int const message_tag,
+                        threading_path const path,
+                        communicator const comm = communicator::world)
+        : partitioned_requests(buffer.size(), partitions, path)
+    {
+        auto* data = buffer.data();
+        auto const type = data_type<typename T::value_type>::value_type();
+        auto const handle = comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF;
+
+#if MPI_VERSION >= 4
+        MPI_Precv_init(data,
+                       partitions,
+                       partition_size,
+                       type,
+                       source_process,
+                       message_tag,
+                       handle,
+                       MPI_INFO_NULL,
+                       &requests.front());
+#else
+        for (int partition = 0; partition < partitions; ++partition)
+        {
+            MPI_Recv_init(data + partition * partition_size,
+                          partition_size,
+                          type,
+                          source_process,
+                          tag_of(message_tag, partition),
+                          handle,
+                          &requests[partition]);
+        }
+#endif
+    }
+
+    /// Begin receiving.  Called on the creating thread.
+    void start()
+    {
+        clear_flags();
+
+        MPI_Startall(requests.size(), requests.data());
+    }
+
+    /// \return true if \p partition has arrived and can be read
+    bool arrived(int const partition)
+    {
+        if (flags[partition].load(std::memory_order_acquire)) return true;
+
+        if (selected_path == threading_path::per_thread_communicators)
+        {
+            return test_partition(partition);
+        }
+        if (is_creator()) progress();
+
+        return flags[partition].load(std::memory_order_acquire);
+    }
+
+    /// Check which partitions have arrived.  Only called on the creating
+    /// thread and does nothing when threads check their own.
+    void progress()
+    {
+        if (selected_path != threading_path::funnel) return;
+
+        for (int partition = 0; partition < partition_count; ++partition)
+        {
+            if (!flags[partition].load(std::memory_order_relaxed)) test_partition(partition);
+        }
+    }
+
+    /// Wait until every partition has arrived
+    void wait()
+    {
+        while (selected_path == threading_path::funnel && flagged.load() < partition_count)
+        {
+            progress();
+            std::this_thread::yield();
+        }
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    }
+
+private:
+    bool test_partition(int const partition)
+    {
+        int has_arrived = 0;
+#if MPI_VERSION >= 4
+        MPI_Parrived(requests.front(), partition, &has_arrived);
+#else
+        MPI_Test(&requests[partition], &has_arrived, MPI_STATUS_IGNORE);
+#endif
+        if (has_arrived && !flags[partition].exchange(true, std::memory_order_acq_rel))
+        {
+            ++flagged;
+        }
+        return has_arrived != 0;
+    }
+};
+}
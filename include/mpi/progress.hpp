@@ -0,0 +1,345 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// \file progress.hpp
+/// \brief Background thread driving nonblocking operations to completion
+
+namespace mpi
+{
+namespace detail
+{
+/// Operation submitted to a progress_engine
+struct submission
+{
+    /// Starts the operation on the progress thread
+    std::function<request()> start;
+    /// Called on the progress thread once the operation has completed
+    std::function<void(status const&)> complete;
+
+    submission* next = nullptr;
+};
+
+/// submission_queue is a lock-free queue with many producers and a single
+/// consumer.  Producers push onto a linked stack with compare and swap and the
+/// consumer takes the whole stack at once, so there is no ABA problem, and
+/// reverses it to restore the submission order.
+class submission_queue
+{
+public:
+    ~submission_queue() { take_all(); }
+
+    void push(std::unique_ptr<submission> entry)
+    {
+        auto* node = entry.release();
+
+        node->next = head.load(std::memory_order_relaxed);
+
+        while (!head.compare_exchange_weak(node->next,
+                                           node,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /// \return The submissions in the order they were pushed
+    std::vector<std::unique_ptr<submission>> take_all()
+    {
+        std::vector<std::unique_ptr<submission>> entries;
+
+        for (auto* node = head.exchange(nullptr, std::memory_order_acquire); node != nullptr;)
+        {
+            auto* next = node->next;
+            entries.emplace_back(node);
+            node = next;
+        }
+        std::reverse(begin(entries), end(entries));
+
+        return entries;
+    }
+
+    bool empty() const { return head.load() == nullptr; }
+
+private:
+    std::atomic<submission*> head{nullptr};
+};
+
+/// active_requests holds the started operations of a single thread and
+/// completes them with \p MPI_Testsome
+class active_requests
+{
+public:
+    /// Start the operation, completing it at once if there is no request
+    void start(std::unique_ptr<submission> entry)
+    {
+        auto const started = entry->start();
+
+        if (started == MPI_REQUEST_NULL)
+        {
+            ++completed_count;
+
+            status empty_status{};
+            entry->complete(empty_status);
+            return;
+        }
+        requests.push_back(started);
+        operations.push_back(std::move(entry));
+    }
+
+    /// Run the callbacks of the operations that have completed
+    /// \return false if none had completed
+    bool test_some()
+    {
+        if (requests.empty()) return false;
+
+        indices.resize(requests.size());
+        statuses.resize(requests.size());
+
+        int completions = 0;
+        MPI_Testsome(requests.size(),
+                     requests.data(),
+                     &completions,
+                     indices.data(),
+                     statuses.data());
+
+        if (completions == 0 || completions == MPI_UNDEFINED) return false;
+
+        // Count before the callbacks so a fulfilled future implies the count
+        completed_count += completions;
+
+        for (int completion = 0; completion < completions; ++completion)
+        {
+            operations[indices[completion]]->complete(statuses[completion]);
+        }
+
+        // Completed requests have been set to MPI_REQUEST_NULL
+        std::size_t kept = 0;
+        for (std::size_t index = 0; index < requests.size(); ++index)
+        {
+            if (requests[index] == MPI_REQUEST_NULL) continue;
+
+            requests[kept] = requests[index];
+            operations[kept] = std::move(operations[index]);
+            ++kept;
+        }
+        requests.resize(kept);
+        operations.resize(kept);
+
+        return true;
+    }
+
+    bool empty() const { return requests.empty(); }
+
+    /// \return The number of operations completed, safe to call from any thread
+    std::size_t completed() const { return completed_count.load(); }
+
+private:
+    std::vector<request> requests;
+    std::vector<std::unique_ptr<submission>> operations;
+
+    std::vector<int> indices;
+    std::vector<status> statuses;
+
+    std::atomic<std::size_t> completed_count{0};
+};
+}
+
+/// progress_engine owns a background thread that starts the operations
+/// submitted by any number of threads and drives them to completion with
+/// \p MPI_Testsome, so large nonblocking transfers advance while the
+/// submitting threads compute.  Completion is reported through a std::future
+/// or a callback run on the progress thread.
+///
+/// Only the progress thread calls MPI, so \p MPI_THREAD_SERIALIZED is enough
+/// provided no other thread communicates while the engine is running.  Other
+/// threads may communicate concurrently with \p MPI_THREAD_MULTIPLE.
+/// Operations from one thread are started in the order they were submitted.
+///
+/// The buffers of an operation must stay alive and untouched until it has
+/// completed.  The destructor waits for all submitted operations.
+class progress_engine
+{
+public:
+    progress_engine()
+    {
+        int thread_provided;
+        MPI_Query_thread(&thread_provided);
+
+        if (thread_provided < MPI_THREAD_SERIALIZED)
+        {
+            throw std::runtime_error("mpi::progress_engine requires MPI to be initialised with "
+                                     "thread::serialised or thread::multiple");
+        }
+        worker = std::thread([this] { run(); });
+    }
+
+    progress_engine(progress_engine const&) = delete;
+    progress_engine& operator=(progress_engine const&) = delete;
+
+    ~progress_engine()
+    {
+        stopping = true;
+        wake();
+        worker.join();
+    }
+
+    /// Submit an operation
+    /// \param start Called on the progress thread to start the operation,
+    ///              returning its request or \p MPI_REQUEST_NULL if it is
+    ///              already complete
+    /// \param on_complete Called on the progress thread with the status of the
+    ///                    completed operation.  It must not throw or block.
+    template <typename Start_Tp, typename Callback_Tp>
+    void submit(Start_Tp&& start, Callback_Tp&& on_complete)
+    {
+        auto entry = std::make_unique<detail::submission>();
+        entry->start = std::forward<Start_Tp>(start);
+        entry->complete = std::forward<Callback_Tp>(on_complete);
+
+        submissions.push(std::move(entry));
+        wake();
+    }
+
+    /// Submit an operation \sa submit(Start_Tp&&, Callback_Tp&&)
+    /// \return A future holding the status of the completed operation
+    template <typename Start_Tp>
+    std::future<status> submit(Start_Tp&& start)
+    {
+        auto promise = std::make_shared<std::promise<status>>();
+        auto completion = promise->get_future();
+
+        submit(std::forward<Start_Tp>(start),
+               [promise](status const& completed) { promise->set_value(completed); });
+
+        return completion;
+    }
+
+    /// Send \p data, a built-in value or a contiguous vector of built-in types.
+    /// The data is read on the progress thread, so it must outlive the future.
+    /// \return A future holding the status of the completed send
+    template <typename T>
+    std::future<status> send(T const& data,
+                             int const destination_process,
+                             int const message_tag = 0,
+                             communicator const comm = communicator::world)
+    {
+        return submit([&data, destination_process, message_tag, comm] {
+            return mpi::send(async{}, data, destination_process, message_tag, comm);
+        });
+    }
+
+    /// Send a temporary, which is moved into the operation and kept until the
+    /// send has completed
+    /// \return A future holding the status of the completed send
+    template <typename T, typename = std::enable_if_t<!std::is_lvalue_reference<T>::value>>
+    std::future<status> send(T&& data,
+                             int const destination_process,
+                             int const message_tag = 0,
+                             communicator const comm = communicator::world)
+    {
+        auto const owned = std::make_shared<std::decay_t<T> const>(std::move(data));
+
+        // The submission holds the data until the operation has completed
+        return submit([owned, destination_process, message_tag, comm] {
+            return mpi::send(async{}, *owned, destination_process, message_tag, comm);
+        });
+    }
+
+    /// Receive into \p data, a built-in value or a contiguous vector of
+    /// built-in types already sized to the message.  The data is written on
+    /// the progress thread, so it must outlive the future.
+    /// \return A future holding the status of the completed receive
+    template <typename T>
+    std::future<status> receive(T& data,
+                                int const source_process,
+                                int const message_tag = 0,
+                                communicator const comm = communicator::world)
+    {
+        return submit([&data, source_process, message_tag, comm] {
+            return mpi::receive(async{}, data, source_process, message_tag, comm);
+        });
+    }
+
+    /// Receiving into a temporary would write to destroyed storage
+    template <typename T>
+    std::future<status> receive(T const&& data,
+                                int const source_process,
+                                int const message_tag = 0,
+                                communicator const comm = communicator::world) = delete;
+
+    /// \return The number of operations completed by the engine
+    std::size_t completed() const { return operations.completed(); }
+
+private:
+    void wake()
+    {
+        if (sleeping.load())
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            wake_up.notify_one();
+        }
+    }
+
+    /// Wait for a submission when there is nothing to make progress on
+    void sleep()
+    {
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+
+        sleeping = true;
+
+        if (submissions.empty() && !stopping)
+        {
+            wake_up.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        sleeping = false;
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            for (auto& entry : submissions.take_all()) operations.start(std::move(entry));
+
+            if (operations.empty())
+            {
+                if (stopping && submissions.empty()) return;
+
+                sleep();
+                continue;
+            }
+
+            if (!operations.test_some()) std::this_thread::yield();
+        }
+    }
+
+private:
+    detail::submission_queue submissions;
+
+    /// Operations started by the progress thread
+    detail::active_requests operations;
+
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> sleeping{false};
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake_up;
+
+    std::thread worker;
+};
+}
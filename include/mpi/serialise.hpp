@@ -0,0 +1,665 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// \file serialise.hpp
+/// \brief Nested and variable length containers sent as a single message
+
+namespace mpi
+{
+/// flattened is a type tag that sends a nested or variable length container,
+/// such as a std::vector<std::string>, a std::vector<std::vector<T>> or a
+/// std::map, as a single message.  Each level of nesting is written as a
+/// header holding the number of elements and the offset of the end of each
+/// element, followed by the elements.  Values with a data_type and contiguous
+/// vectors of them are copied as raw bytes.
+/// \sa jagged_view
+struct flattened
+{
+};
+
+namespace detail
+{
+/// Integer type of the counts and offsets in a flattened header
+using flat_size = std::uint64_t;
+
+constexpr std::size_t align_up(std::size_t const offset, std::size_t const alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+constexpr std::size_t larger(std::size_t const left, std::size_t const right)
+{
+    return left > right ? left : right;
+}
+
+/// \return The size of a header for \p count elements in bytes
+constexpr std::size_t header_size(std::size_t const count)
+{
+    return sizeof(flat_size) * (count + 2);
+}
+
+/// true if \p T is copied as raw bytes
+template <typename T>
+struct is_flat_value
+    : std::integral_constant<bool, has_data_type<T>::value && std::is_trivially_copyable<T>::value>
+{
+};
+
+/// true if \p T is a resizable contiguous sequence of flat values, such as a
+/// std::vector<double> or a std::string
+template <typename T, typename = void>
+struct is_flat_sequence : std::false_type
+{
+};
+
+template <typename T>
+struct is_flat_sequence<T,
+                        void_t<typename T::value_type,
+                               decltype(std::declval<T&>().data()),
+                               decltype(std::declval<T&>().resize(0))>>
+    : std::integral_constant<bool,
+                             is_flat_value<typename T::value_type>::value
+                                 && !has_data_type<T>::value>
+{
+};
+
+/// true if \p T is a range of elements that are flattened one by one
+template <typename T, typename = void>
+struct is_nested_range : std::false_type
+{
+};
+
+template <typename T>
+struct is_nested_range<T,
+                       void_t<typename T::value_type,
+                              decltype(std::declval<T const&>().begin()),
+                              decltype(std::declval<T const&>().end())>>
+    : std::integral_constant<bool, !is_flat_sequence<T>::value && !has_data_type<T>::value>
+{
+};
+
+/// The element type to unpack into, without the const key of a map
+template <typename T>
+struct unpacked
+{
+    using type = T;
+};
+
+template <typename First_Tp, typename Second_Tp>
+struct unpacked<std::pair<First_Tp, Second_Tp>>
+{
+    using type = std::pair<std::remove_const_t<First_Tp>, Second_Tp>;
+};
+
+template <typename T>
+using unpacked_t = typename unpacked<T>::type;
+
+inline std::runtime_error malformed_message()
+{
+    return std::runtime_error("mpi::flattened: the message does not match the received type");
+}
+
+/// \return \p bytes as the int counts of the MPI calls that send a message
+inline int message_size(std::size_t const bytes)
+{
+    if (bytes > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+    {
+        throw std::runtime_error("mpi::flattened: a message of " + std::to_string(bytes)
+                                 + " bytes is too large to send");
+    }
+    return static_cast<int>(bytes);
+}
+
+/// header_writer reserves the header of a nested value at the end of a
+/// buffer and records the offset of the end of each element appended after it
+class header_writer
+{
+public:
+    header_writer(std::vector<char>& buffer, std::size_t const count)
+        : buffer(buffer), start(buffer.size()), offsets(count + 1)
+    {
+        buffer.resize(start + header_size(count));
+        offsets.front() = header_size(count);
+    }
+
+    /// Pad the buffer so the next element starts at \p alignment
+    void align(std::size_t const alignment)
+    {
+        buffer.resize(start + align_up(buffer.size() - start, alignment));
+    }
+
+    /// Record the end of the element just appended
+    void end_element() { offsets[++index] = buffer.size() - start; }
+
+    /// Write the count and the offsets into the reserved header
+    void finish()
+    {
+        flat_size const count = offsets.size() - 1;
+
+        std::memcpy(buffer.data() + start, &count, sizeof(flat_size));
+        std::memcpy(buffer.data() + start + sizeof(flat_size),
+                    offsets.data(),
+                    offsets.size() * sizeof(flat_size));
+    }
+
+private:
+    std::vector<char>& buffer;
+    std::size_t start;
+
+    std::vector<flat_size> offsets;
+    std::size_t index = 0;
+};
+
+/// header_reader checks the header of a nested value and locates its elements
+class header_reader
+{
+public:
+    header_reader(char const* first, char const* last) : first(first)
+    {
+        std::size_t const bytes = last - first;
+
+        if (bytes < header_size(0)) throw malformed_message();
+
+        std::memcpy(&element_count, first, sizeof(flat_size));
+
+        if (element_count > bytes / sizeof(flat_size) - 2) throw malformed_message();
+
+        offsets.resize(element_count + 1);
+        std::memcpy(offsets.data(), first + sizeof(flat_size), offsets.size() * sizeof(flat_size));
+
+        if (offsets.front() != header_size(element_count)) throw malformed_message();
+
+        // Every element has to end inside the message and after the one before it
+        for (std::size_t index = 1; index < offsets.size(); ++index)
+        {
+            if (offsets[index] < offsets[index - 1] || offsets[index] > bytes)
+            {
+                throw malformed_message();
+            }
+        }
+    }
+
+    std::size_t count() const { return element_count; }
+
+    /// \return The first and one past the last byte of element \p index
+    std::pair<char const*, char const*> element(std::size_t const index,
+                                                std::size_t const alignment) const
+    {
+        auto const begin = align_up(offsets[index], alignment);
+
+        if (begin > offsets[index + 1]) throw malformed_message();
+
+        return {first + begin, first + offsets[index + 1]};
+    }
+
+private:
+    char const* first;
+
+    flat_size element_count;
+    std::vector<flat_size> offsets;
+};
+
+/// flattener packs a value into a buffer and unpacks it from the bytes of a
+/// message.  alignment() is the alignment of the first byte of the value,
+/// which the caller pads to.
+template <typename T, typename = void>
+struct flattener;
+
+template <typename T>
+struct flattener<T, std::enable_if_t<is_flat_value<T>::value>>
+{
+    static constexpr std::size_t alignment() { return alignof(T); }
+
+    static void pack(T const& value, std::vector<char>& buffer)
+    {
+        auto const start = buffer.size();
+        buffer.resize(start + sizeof(T));
+        std::memcpy(buffer.data() + start, &value, sizeof(T));
+    }
+
+    static void unpack(char const* first, char const* last, T& value)
+    {
+        if (static_cast<std::size_t>(last - first) != sizeof(T)) throw malformed_message();
+
+        std::memcpy(&value, first, sizeof(T));
+    }
+};
+
+template <typename T>
+struct flattener<T, std::enable_if_t<is_flat_sequence<T>::value>>
+{
+    using value_type = typename T::value_type;
+
+    static constexpr std::size_t alignment() { return alignof(value_type); }
+
+    static void pack(T const& values, std::vector<char>& buffer)
+    {
+        auto const start = buffer.size();
+        buffer.resize(start + values.size() * sizeof(value_type));
+
+        if (!values.empty())
+        {
+            std::memcpy(buffer.data() + start, values.data(), values.size() * sizeof(value_type));
+        }
+    }
+
+    static void unpack(char const* first, char const* last, T& values)
+    {
+        std::size_t const bytes = last - first;
+
+        if (bytes % sizeof(value_type) != 0) throw malformed_message();
+
+        values.resize(bytes / sizeof(value_type));
+
+        if (bytes > 0) std::memcpy(&values[0], first, bytes);
+    }
+};
+
+template <typename T>
+struct flattener<T, std::enable_if_t<is_nested_range<T>::value>>
+{
+    using element_flattener = flattener<unpacked_t<typename T::value_type>>;
+
+    static constexpr std::size_t alignment()
+    {
+        return larger(alignof(flat_size), element_flattener::alignment());
+    }
+
+    static void pack(T const& values, std::vector<char>& buffer)
+    {
+        header_writer header(buffer, std::distance(values.begin(), values.end()));
+
+        for (auto const& value : values)
+        {
+            header.align(element_flattener::alignment());
+            element_flattener::pack(value, buffer);
+            header.end_element();
+        }
+        header.finish();
+    }
+
+    static void unpack(char const* first, char const* last, T& values)
+    {
+        header_reader const header(first, last);
+
+        for (std::size_t index = 0; index < header.count(); ++index)
+        {
+            auto const bytes = header.element(index, element_flattener::alignment());
+
+            unpacked_t<typename T::value_type> value;
+            element_flattener::unpack(bytes.first, bytes.second, value);
+
+            values.insert(values.end(), std::move(value));
+        }
+    }
+};
+
+/// A pair, including the key and value of a map, is a nested value of two
+/// elements
+template <typename First_Tp, typename Second_Tp>
+struct flattener<std::pair<First_Tp, Second_Tp>>
+{
+    using first_flattener = flattener<std::remove_const_t<First_Tp>>;
+    using second_flattener = flattener<Second_Tp>;
+
+    static constexpr std::size_t alignment()
+    {
+        return larger(alignof(flat_size),
+                      larger(first_flattener::alignment(), second_flattener::alignment()));
+    }
+
+    template <typename Pair_Tp>
+    static void pack(Pair_Tp const& value, std::vector<char>& buffer)
+    {
+        header_writer header(buffer, 2);
+
+        header.align(first_flattener::alignment());
+        first_flattener::pack(value.first, buffer);
+        header.end_element();
+
+        header.align(second_flattener::alignment());
+        second_flattener::pack(value.second, buffer);
+        header.end_element();
+
+        header.finish();
+    }
+
+    static void unpack(char const* first,
+                       char const* last,
+                       std::pair<std::remove_const_t<First_Tp>, Second_Tp>& value)
+    {
+        header_reader const header(first, last);
+
+        if (header.count() != 2) throw malformed_message();
+
+        auto const first_bytes = header.element(0, first_flattener::alignment());
+        first_flattener::unpack(first_bytes.first, first_bytes.second, value.first);
+
+        auto const second_bytes = header.element(1, second_flattener::alignment());
+        second_flattener::unpack(second_bytes.first, second_bytes.second, value.second);
+    }
+};
+
+/// true if \p T is a range of flat sequences, which is sent without packing
+template <typename T, typename = void>
+struct is_jagged : std::false_type
+{
+};
+
+template <typename T>
+struct is_jagged<T, std::enable_if_t<is_nested_range<T>::value>>
+    : is_flat_sequence<typename T::value_type>
+{
+};
+
+/// message_storage holds the bytes of a received message, aligned for any
+/// flat value so they can be read in place
+class message_storage
+{
+public:
+    message_storage() = default;
+
+    explicit message_storage(std::size_t const bytes)
+        : words((bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)), bytes(bytes)
+    {
+    }
+
+    char* data() { return reinterpret_cast<char*>(words.data()); }
+    char const* data() const { return reinterpret_cast<char const*>(words.data()); }
+
+    std::size_t size() const { return bytes; }
+
+private:
+    std::vector<std::max_align_t> words;
+    std::size_t bytes = 0;
+};
+
+/// \return The packed bytes of \p value
+template <typename T>
+std::vector<char> pack(T const& value)
+{
+    std::vector<char> buffer;
+    flattener<T>::pack(value, buffer);
+    return buffer;
+}
+
+/// Send a range of flat sequences through a datatype that addresses the
+/// header and every sequence where it is (\p MPI_Type_create_hindexed) so
+/// none of the data is copied
+template <typename T>
+void send_flattened(T const& values,
+                    int const destination_process,
+                    int const message_tag,
+                    MPI_Comm const comm,
+                    std::true_type)
+{
+    using value_type = typename T::value_type::value_type;
+
+    std::size_t const count = std::distance(values.begin(), values.end());
+
+    // The header words are followed by padding up to the first value
+    auto const payload_start = align_up(header_size(count), alignof(value_type));
+
+    std::vector<flat_size> header(align_up(payload_start, sizeof(flat_size)) / sizeof(flat_size));
+    header[0] = count;
+    header[1] = header_size(count);
+
+    std::vector<int> block_lengths{message_size(payload_start)};
+    std::vector<MPI_Aint> displacements{address(header.data())};
+
+    auto end = payload_start;
+    std::size_t index = 2;
+
+    for (auto const& sequence : values)
+    {
+        auto const bytes = sequence.size() * sizeof(value_type);
+
+        end += bytes;
+        header[index++] = end;
+
+        if (bytes == 0) continue;
+
+        // The whole message is received with an int count, which also bounds
+        // every block length and the number of blocks
+        message_size(end);
+
+        block_lengths.push_back(static_cast<int>(bytes));
+        displacements.push_back(address(sequence.data()));
+    }
+
+    MPI_Datatype message_type;
+    MPI_Type_create_hindexed(block_lengths.size(),
+                             block_lengths.data(),
+                             displacements.data(),
+                             MPI_BYTE,
+                             &message_type);
+    MPI_Type_commit(&message_type);
+
+    MPI_Send(MPI_BOTTOM, 1, message_type, destination_process, message_tag, comm);
+
+    MPI_Type_free(&message_type);
+}
+
+/// Send any other value packed into a buffer
+template <typename T>
+void send_flattened(T const& values,
+                    int const destination_process,
+                    int const message_tag,
+                    MPI_Comm const comm,
+                    std::false_type)
+{
+    auto const buffer = pack(values);
+
+    MPI_Send(buffer.data(),
+             message_size(buffer.size()),
+             MPI_BYTE,
+             destination_process,
+             message_tag,
+             comm);
+}
+}
+
+/// jagged_view reads a received range of contiguous sequences, such as a
+/// std::vector<std::vector<T>> or a std::vector<std::string>, in place from
+/// the message without unpacking it
+/// \tparam T The values of the inner sequences
+template <typename T>
+class jagged_view
+{
+public:
+    /// One of the inner sequences
+    class row
+    {
+    public:
+        row(T const* first, std::size_t const count) : first(first), count(count) {}
+
+        T const* data() const { return first; }
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        T const* begin() const { return first; }
+        T const* end() const { return first + count; }
+
+        T const& operator[](std::size_t const index) const { return first[index]; }
+
+    private:
+        T const* first;
+        std::size_t count;
+    };
+
+public:
+    static_assert(detail::is_flat_value<T>::value, "jagged_view requires values with a data_type");
+
+    jagged_view() = default;
+
+    // The rows point into the storage, which a copy would not share
+    jagged_view(jagged_view const&) = delete;
+    jagged_view& operator=(jagged_view const&) = delete;
+
+    jagged_view(jagged_view&&) = default;
+    jagged_view& operator=(jagged_view&&) = default;
+
+    explicit jagged_view(detail::message_storage storage) : storage(std::move(storage))
+    {
+        detail::header_reader const header(this->storage.data(),
+                                           this->storage.data() + this->storage.size());
+
+        rows.reserve(header.count());
+
+        for (std::size_t index = 0; index < header.count(); ++index)
+        {
+            auto const bytes = header.element(index, alignof(T));
+
+            if ((bytes.second - bytes.first) % sizeof(T) != 0) throw detail::malformed_message();
+
+            rows.emplace_back(reinterpret_cast<T const*>(bytes.first),
+                              (bytes.second - bytes.first) / sizeof(T));
+        }
+    }
+
+    /// \return The number of sequences
+    std::size_t size() const { return rows.size(); }
+
+    bool empty() const { return rows.empty(); }
+
+    row const& operator[](std::size_t const index) const { return rows[index]; }
+
+    typename std::vector<row>::const_iterator begin() const { return rows.begin(); }
+    typename std::vector<row>::const_iterator end() const { return rows.end(); }
+
+private:
+    detail::message_storage storage;
+    std::vector<row> rows;
+};
+
+namespace detail
+{
+template <typename T>
+struct is_jagged_view : std::false_type
+{
+};
+
+template <typename T>
+struct is_jagged_view<jagged_view<T>> : std::true_type
+{
+};
+
+template <typename T>
+auto from_message(message_storage storage) -> std::enable_if_t<!is_jagged_view<T>::value, T>
+{
+    T value;
+    flattener<T>::unpack(storage.data(), storage.data() + storage.size(), value);
+    return value;
+}
+
+template <typename T>
+auto from_message(message_storage storage) -> std::enable_if_t<is_jagged_view<T>::value, T>
+{
+    return T(std::move(storage));
+}
+}
+
+/// Send a nested or variable length container as one message.  A range of
+/// contiguous sequences is sent in place, other values are packed first.
+/// \sa flattened
+/// \param values Container to send
+/// \param destination_process Process to send to
+/// \param message_tag Tag of the message
+/// \param comm Communicator type
+template <typename T>
+inline void send(flattened,
+                 T const& values,
+                 int const destination_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+{
+    detail::send_flattened(values,
+                           destination_process,
+                           message_tag,
+                           comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+                           detail::is_jagged<T>{});
+}
+
+/// Receive a container sent with flattened.  The message is probed and
+/// removed from the queue (\p MPI_Mprobe) before it is received.
+/// \tparam T Container to unpack into, or a jagged_view reading the message
+///           in place
+/// \param source_process Process to receive from
+/// \param message_tag Matching tag to the message
+/// \param comm Communicator type
+/// \return The received container
+template <typename T>
+inline T receive(flattened,
+                 int const source_process,
+                 int const message_tag = 0,
+                 communicator const comm = communicator::world)
+{
+    status probe_status;
+    MPI_Message message;
+
+    MPI_Mprobe(source_process,
+               message_tag,
+               comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+               &message,
+               &probe_status);
+
+    int bytes;
+    MPI_Get_count(&probe_status, MPI_BYTE, &bytes);
+
+    detail::message_storage storage(bytes);
+
+    MPI_Mrecv(storage.data(), bytes, MPI_BYTE, &message, MPI_STATUS_IGNORE);
+
+    return detail::from_message<T>(std::move(storage));
+}
+
+/// broadcast sends a nested or variable length container from the
+/// host_processor to every process, first its packed size and then the
+/// packed bytes
+/// \sa flattened
+/// \param values Container to send if we are the host_processor
+/// \param host_processor Process responsible for sending out the data
+/// \param comm MPI communicator
+/// \return The broadcast container
+template <typename T>
+inline T broadcast(flattened,
+                   T values,
+                   int const host_processor = 0,
+                   communicator const comm = communicator::world)
+{
+    auto const handle = comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF;
+
+    auto const is_host = host_processor == ::mpi::rank(comm);
+
+    std::vector<char> buffer;
+
+    if (is_host) buffer = detail::pack(values);
+
+    std::uint64_t bytes = buffer.size();
+    MPI_Bcast(&bytes, 1, MPI_UINT64_T, host_processor, handle);
+
+    detail::message_storage storage(bytes);
+
+    if (is_host && bytes > 0) std::memcpy(storage.data(), buffer.data(), bytes);
+
+    // Every process knows the size, so all of them throw if it is too large
+    MPI_Bcast(storage.data(), detail::message_size(bytes), MPI_BYTE, host_processor, handle);
+
+    if (is_host) return values;
+
+    return detail::from_message<T>(std::move(storage));
+}
+}
@@ -0,0 +1,337 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// \file sort.hpp
+/// \brief Distributed sample sort built on the collective operations
+
+namespace mpi
+{
+/// Wall clock time in seconds spent by this process in each phase of a sort
+struct sort_timings
+{
+    /// Sorting the local data
+    double local_sort = 0.0;
+    /// Selecting the regular samples, gathering them and choosing the splitters
+    double sampling = 0.0;
+    /// Splitting the local data into one block per destination process
+    double partition = 0.0;
+    /// Redistributing the blocks with an all to all operation
+    double exchange = 0.0;
+    /// Merging the sorted blocks received from each process
+    double merge = 0.0;
+
+    double total() const { return local_sort + sampling + partition + exchange + merge; }
+};
+
+namespace detail
+{
+/// Sort [first, last) with up to \p thread_count threads.  Equal sized chunks
+/// are sorted concurrently and then merged pairwise, also concurrently.
+template <typename RandomIt, typename Compare>
+inline void parallel_sort(RandomIt first, RandomIt last, Compare compare, unsigned thread_count)
+{
+    // Below this size the cost of starting threads outweighs the gain
+    constexpr std::ptrdiff_t minimum_chunk_size = 1 << 15;
+
+    auto const size = std::distance(first, last);
+
+    auto const chunks = std::min<std::ptrdiff_t>(thread_count, size / minimum_chunk_size);
+
+    if (chunks <= 1)
+    {
+        std::sort(first, last, compare);
+        return;
+    }
+
+    std::vector<RandomIt> bounds(chunks + 1);
+    for (std::ptrdiff_t chunk = 0; chunk <= chunks; ++chunk)
+    {
+        bounds[chunk] = std::next(first, size * chunk / chunks);
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(chunks);
+
+    for (std::ptrdiff_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        threads.emplace_back(
+            [&, chunk] { std::sort(bounds[chunk], bounds[chunk + 1], compare); });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (std::ptrdiff_t width = 1; width < chunks; width *= 2)
+    {
+        threads.clear();
+        for (std::ptrdiff_t chunk = 0; chunk + width < chunks; chunk += 2 * width)
+        {
+            threads.emplace_back([&, chunk, width] {
+                std::inplace_merge(bounds[chunk],
+                                   bounds[chunk + width],
+                                   bounds[std::min(chunk + 2 * width, chunks)],
+                                   compare);
+            });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+}
+
+/// Merge the consecutive sorted runs in \p runs into \p output using a binary
+/// heap holding the front of each run.  Equal values keep the run order.
+template <typename T, typename Compare>
+inline void merge_runs(std::vector<T> const& runs,
+                       std::vector<int> const& run_sizes,
+                       std::vector<T>& output,
+                       Compare compare)
+{
+    struct cursor
+    {
+        std::size_t position;
+        std::size_t end;
+    };
+
+    std::vector<cursor> heap;
+    heap.reserve(run_sizes.size());
+
+    std::size_t run_start = 0;
+    for (auto const run_size : run_sizes)
+    {
+        if (run_size > 0) heap.push_back({run_start, run_start + run_size});
+        run_start += run_size;
+    }
+
+    output.resize(runs.size());
+
+    if (heap.size() == 1)
+    {
+        std::copy(begin(runs), end(runs), begin(output));
+        return;
+    }
+
+    // std::push_heap builds a max heap, so order the cursors in reverse
+    auto const later = [&](cursor const& lhs, cursor const& rhs) {
+        return compare(runs[rhs.position], runs[lhs.position])
+               || (!compare(runs[lhs.position], runs[rhs.position])
+                   && rhs.position < lhs.position);
+    };
+
+    std::make_heap(begin(heap), end(heap), later);
+
+    auto destination = begin(output);
+
+    while (!heap.empty())
+    {
+        std::pop_heap(begin(heap), end(heap), later);
+
+        auto& front = heap.back();
+
+        *destination++ = runs[front.position++];
+
+        if (front.position == front.end)
+        {
+            heap.pop_back();
+        }
+        else
+        {
+            std::push_heap(begin(heap), end(heap), later);
+        }
+    }
+}
+
+template <typename T>
+inline derived_type sort_element_type(std::true_type)
+{
+    MPI_Datatype element_type;
+    MPI_Type_contiguous(1, data_type<T>::value_type(), &element_type);
+    return derived_type(element_type);
+}
+
+/// Structures are sent as bytes, assuming all processes share a data layout
+template <typename T>
+inline derived_type sort_element_type(std::false_type)
+{
+    MPI_Datatype element_type;
+    MPI_Type_contiguous(sizeof(T), MPI_BYTE, &element_type);
+    return derived_type(element_type);
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point& start)
+{
+    auto const now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> const elapsed = now - start;
+    start = now;
+    return elapsed.count();
+}
+}
+
+/// sample_sorter sorts a vector distributed over the processes of a
+/// communicator so that afterwards the local data on each process is sorted
+/// and all values on process i come before the values on process i + 1.
+///
+/// The algorithm is parallel sorting by regular sampling.  Each process sorts
+/// its data with multiple threads and picks regularly spaced samples, about
+/// max(size(), 64) per process overall with each process contributing in
+/// proportion to its number of values.  The samples are gathered on all
+/// processes and size() - 1 splitters are chosen from them.  The local data is
+/// partitioned by the splitters, redistributed with all_to_allv() and the
+/// sorted runs received from each process are merged.  With regular sampling
+/// no process receives more than about twice the average number of values
+/// unless there are many duplicate values.
+///
+/// The object keeps its buffers between calls so repeated sorts of similar
+/// sized data do not allocate.  The number of values sent to each process
+/// must fit in an int.
+/// \tparam T Arithmetic or trivially copyable value type
+/// \tparam Compare Strict weak ordering of T
+template <typename T, typename Compare = std::less<T>>
+class sample_sorter
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "mpi::sample_sorter requires trivially copyable values");
+
+public:
+    /// \param compare Ordering of the values
+    /// \param comm MPI communicator
+    /// \param thread_count Number of threads for the local sort
+    explicit sample_sorter(Compare compare = Compare{},
+                           communicator const comm = communicator::world,
+                           unsigned const thread_count = std::thread::hardware_concurrency())
+        : compare(compare),
+          comm(comm),
+          thread_count(std::max(thread_count, 1u)),
+          element_type(detail::sort_element_type<T>(std::is_arithmetic<T>{}))
+    {
+    }
+
+    /// Collectively sort \p data, which is replaced by the local part of the
+    /// globally sorted sequence
+    void sort(std::vector<T>& data)
+    {
+        auto const processes = mpi::size(comm);
+
+        auto start = std::chrono::steady_clock::now();
+
+        detail::parallel_sort(begin(data), end(data), compare, thread_count);
+
+        phase_timings.local_sort = detail::seconds_since(start);
+
+        if (processes == 1)
+        {
+            phase_timings.sampling = phase_timings.partition = 0.0;
+            phase_timings.exchange = phase_timings.merge = 0.0;
+            return;
+        }
+
+        // Regular samples from the middle of equally sized intervals.  Taking
+        // more samples than processes keeps the splitters close to the true
+        // quantiles when there are only a few processes.  Each process draws
+        // its share of the samples in proportion to its number of values, so
+        // every sample stands for about the same number of values.
+        auto const total_size = all_reduce(static_cast<unsigned long long>(data.size()),
+                                           sum{},
+                                           comm);
+
+        auto const sample_budget = static_cast<unsigned long long>(std::max(processes, 64))
+                                   * processes;
+
+        std::size_t const sample_count = std::min<unsigned long long>(
+            (sample_budget * data.size() + total_size - 1) / std::max(total_size, 1ull),
+            data.size());
+
+        samples.clear();
+        if (!data.empty())
+        {
+            for (std::size_t sample = 0; sample < sample_count; ++sample)
+            {
+                samples.push_back(data[(2 * sample + 1) * data.size() / (2 * sample_count)]);
+            }
+        }
+
+        detail::all_gather(samples, all_samples, element_type.value_type(), comm);
+
+        std::sort(begin(all_samples), end(all_samples), compare);
+
+        splitters.clear();
+        if (!all_samples.empty())
+        {
+            for (int splitter = 1; splitter < processes; ++splitter)
+            {
+                splitters.push_back(all_samples[splitter * all_samples.size() / processes]);
+            }
+        }
+
+        phase_timings.sampling = detail::seconds_since(start);
+
+        // Values equal to a splitter go to the lower process
+        send_counts.assign(processes, 0);
+
+        auto block_begin = begin(data);
+        for (std::size_t splitter = 0; splitter < splitters.size(); ++splitter)
+        {
+            auto const block_end = std::upper_bound(block_begin,
+                                                    end(data),
+                                                    splitters[splitter],
+                                                    compare);
+            send_counts[splitter] = std::distance(block_begin, block_end);
+            block_begin = block_end;
+        }
+        send_counts.back() = std::distance(block_begin, end(data));
+
+        phase_timings.partition = detail::seconds_since(start);
+
+        auto const receive_counts = detail::all_to_allv(data,
+                                                        send_counts,
+                                                        received,
+                                                        element_type.value_type(),
+                                                        comm);
+
+        phase_timings.exchange = detail::seconds_since(start);
+
+        // The local data has been sent, so its storage is reused for the output
+        detail::merge_runs(received, receive_counts, data, compare);
+
+        phase_timings.merge = detail::seconds_since(start);
+    }
+
+    /// \return The time spent in each phase of the last sort on this process
+    sort_timings const& timings() const { return phase_timings; }
+
+private:
+    Compare compare;
+    communicator comm;
+    unsigned thread_count;
+
+    derived_type element_type;
+
+    /// Buffers reused between phases and between calls
+    std::vector<T> samples, all_samples, splitters, received;
+    std::vector<int> send_counts;
+
+    sort_timings phase_timings;
+};
+
+/// Collectively sort a vector distributed over the processes of a
+/// communicator \sa sample_sorter
+/// \param data Local values, replaced by the local part of the sorted sequence
+/// \param compare Ordering of the values
+/// \param comm MPI communicator
+/// \return The time spent in each phase on this process
+template <typename T, typename Compare = std::less<T>>
+inline sort_timings sort(std::vector<T>& data,
+                         Compare compare = Compare{},
+                         communicator const comm = communicator::world)
+{
+    sample_sorter<T, Compare> sorter(compare, comm);
+    sorter.sort(data);
+    return sorter.timings();
+}
+}
@@ -0,0 +1,291 @@
+
+#pragma once
+
+#include "mpi.hpp"
+#include "mpi/window.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+/// \file task_pool.hpp
+/// \brief Distributed task pool balanced by work stealing
+
+namespace mpi
+{
+/// Counts of the work done by this process in the last task_pool::run()
+struct task_pool_statistics
+{
+    /// Tasks executed
+    std::size_t executed = 0;
+    /// Attempts to steal from another process
+    std::size_t steal_attempts = 0;
+    /// Attempts that returned at least one task
+    std::size_t steals = 0;
+    /// Tasks taken from other processes
+    std::size_t stolen_tasks = 0;
+};
+
+/// task_pool executes tasks that may create further tasks, moving work from
+/// busy processes to idle ones.
+///
+/// Each process keeps a private deque of tasks that it works on from the back
+/// without any synchronisation, and a shared queue in a one-sided window.
+/// When the shared queue has been emptied the owner moves the older half of
+/// its private tasks into it.  An idle process picks a random victim, locks
+/// the victim's shared queue with compare_and_swap() and takes half of the
+/// tasks, so the victim never takes part in a steal.  The owner reclaims its
+/// shared tasks the same way once its private deque is empty.
+///
+/// The number of outstanding tasks is kept in a counter on process zero.  A
+/// process adds the tasks it created less the tasks it completed to the
+/// counter as soon as this difference is positive, and otherwise only when it
+/// runs out of work, so the counter never falls below the true number of
+/// outstanding tasks.  run() returns on every process once it reads zero.
+///
+/// Construction, destruction and run() are collective.
+/// \tparam Task_Tp Trivially copyable description of a task
+template <typename Task_Tp>
+class task_pool
+{
+    static_assert(std::is_trivially_copyable<Task_Tp>::value,
+                  "mpi::task_pool requires trivially copyable tasks");
+
+public:
+    /// \param shared_capacity Maximum number of tasks offered for stealing by
+    ///                        each process at a time
+    /// \param comm MPI communicator
+    explicit task_pool(std::size_t const shared_capacity = 4096,
+                       communicator const comm = communicator::world)
+        : comm(comm),
+          shared_capacity(std::max<std::size_t>(shared_capacity, 1)),
+          shared(tasks_offset + this->shared_capacity * sizeof(Task_Tp), comm),
+          generator(mpi::rank(comm))
+    {
+        auto* header = static_cast<long long*>(shared.data());
+        std::fill(header, header + tasks_offset / sizeof(long long), 0ll);
+
+        shared.sync();
+        barrier(comm);
+    }
+
+    /// Add a task to this process.  Called before run() to create the initial
+    /// tasks, or from a running task to create more work.
+    void push(Task_Tp const& task)
+    {
+        private_tasks.push_back(task);
+        ++unpublished_count;
+    }
+
+    /// Collectively execute all tasks on all processes, including the tasks
+    /// created while running
+    /// \param execute Called with each task, may call push()
+    template <typename Function>
+    void run(Function&& execute)
+    {
+        run_statistics = task_pool_statistics{};
+
+        publish_count();
+        barrier(comm);
+
+        std::size_t const release_interval = 8;
+        std::size_t executed_since_release = 0;
+
+        for (;;)
+        {
+            if (private_tasks.empty() && !reclaim_shared())
+            {
+                publish_count();
+
+                if (shared.load<long long>(0, outstanding_offset) == 0) break;
+
+                steal();
+                continue;
+            }
+
+            auto const task = private_tasks.back();
+            private_tasks.pop_back();
+
+            execute(task);
+
+            ++run_statistics.executed;
+            --unpublished_count;
+
+            if (unpublished_count > 0) publish_count();
+
+            if (++executed_since_release >= release_interval && private_tasks.size() > 1)
+            {
+                executed_since_release = 0;
+                release();
+            }
+        }
+        barrier(comm);
+    }
+
+    /// \return The work done by this process in the last run()
+    task_pool_statistics const& statistics() const { return run_statistics; }
+
+private:
+    /// Add the unpublished change in the number of tasks to the counter
+    void publish_count()
+    {
+        if (unpublished_count == 0) return;
+
+        shared.accumulate(unpublished_count, 0, outstanding_offset, sum{});
+        shared.flush(0);
+
+        unpublished_count = 0;
+    }
+
+    bool try_lock(int const process)
+    {
+        return shared.compare_and_swap(1ll, 0ll, process, lock_offset) == 0;
+    }
+
+    void lock(int const process)
+    {
+        while (!try_lock(process))
+        {
+        }
+    }
+
+    void unlock(int const process) { shared.store(0ll, process, lock_offset); }
+
+    bool has_shared_tasks(int const process)
+    {
+        return shared.load<long long>(process, head_offset)
+               < shared.load<long long>(process, tail_offset);
+    }
+
+    /// Take up to half of the shared tasks of \p process while holding its lock
+    /// \param take_all Take all tasks instead of half
+    std::size_t take_shared(int const process, bool const take_all)
+    {
+        auto const head = shared.load<long long>(process, head_offset);
+        auto const tail = shared.load<long long>(process, tail_offset);
+
+        if (head >= tail) return 0;
+
+        auto const count = take_all ? tail - head : (tail - head + 1) / 2;
+
+        incoming.resize(count);
+        shared.get(incoming.data(),
+                   count * sizeof(Task_Tp),
+                   process,
+                   tasks_offset + head * sizeof(Task_Tp));
+        shared.flush(process);
+
+        shared.store(head + count, process, head_offset);
+
+        private_tasks.insert(end(private_tasks), begin(incoming), end(incoming));
+
+        return count;
+    }
+
+    /// Move the shared tasks of this process back to its private deque
+    bool reclaim_shared()
+    {
+        auto const process = mpi::rank(comm);
+
+        if (!has_shared_tasks(process)) return false;
+
+        lock(process);
+        auto const count = take_shared(process, true);
+        unlock(process);
+
+        return count > 0;
+    }
+
+    /// Offer the older half of the private tasks if the shared queue is empty
+    void release()
+    {
+        auto const process = mpi::rank(comm);
+
+        if (mpi::size(comm) == 1 || has_shared_tasks(process)) return;
+
+        auto const count = std::min(private_tasks.size() / 2, shared_capacity);
+
+        outgoing.assign(begin(private_tasks), begin(private_tasks) + count);
+
+        lock(process);
+
+        shared.put(outgoing.data(), count * sizeof(Task_Tp), process, tasks_offset);
+        shared.flush(process);
+
+        shared.store(0ll, process, head_offset);
+        shared.store(static_cast<long long>(count), process, tail_offset);
+
+        unlock(process);
+
+        private_tasks.erase(begin(private_tasks), begin(private_tasks) + count);
+    }
+
+    /// Try to take tasks from a random process
+    void steal()
+    {
+        auto const processes = mpi::size(comm);
+
+        if (processes == 1) return;
+
+        // Pick uniformly from the other processes
+        auto victim = std::uniform_int_distribution<int>(0, processes - 2)(generator);
+        if (victim >= mpi::rank(comm)) ++victim;
+
+        ++run_statistics.steal_attempts;
+
+        if (!has_shared_tasks(victim) || !try_lock(victim)) return;
+
+        auto const count = take_shared(victim, false);
+
+        unlock(victim);
+
+        if (count > 0)
+        {
+            ++run_statistics.steals;
+            run_statistics.stolen_tasks += count;
+        }
+    }
+
+private:
+    /// Layout of the window on each process, in bytes
+    static constexpr MPI_Aint lock_offset = 0;
+    static constexpr MPI_Aint head_offset = sizeof(long long);
+    static constexpr MPI_Aint tail_offset = 2 * sizeof(long long);
+    /// Number of outstanding tasks, used on process zero only
+    static constexpr MPI_Aint outstanding_offset = 3 * sizeof(long long);
+    static constexpr MPI_Aint tasks_offset = 4 * sizeof(long long);
+
+    communicator comm;
+
+    std::size_t shared_capacity;
+
+    /// Lock, head and tail of the shared queue followed by its tasks
+    window shared;
+
+    std::deque<Task_Tp> private_tasks;
+
+    /// Buffers for moving tasks in and out of the window
+    std::vector<Task_Tp> incoming, outgoing;
+
+    /// Tasks created less tasks completed not yet added to the counter
+    long long unpublished_count = 0;
+
+    std::mt19937 generator;
+
+    task_pool_statistics run_statistics;
+};
+
+template <typename Task_Tp>
+constexpr MPI_Aint task_pool<Task_Tp>::lock_offset;
+template <typename Task_Tp>
+constexpr MPI_Aint task_pool<Task_Tp>::head_offset;
+template <typename Task_Tp>
+constexpr MPI_Aint task_pool<Task_Tp>::tail_offset;
+template <typename Task_Tp>
+constexpr MPI_Aint task_pool<Task_Tp>::outstanding_offset;
+template <typename Task_Tp>
+constexpr MPI_Aint task_pool<Task_Tp>::tasks_offset;
+}
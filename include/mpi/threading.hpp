@@ -0,0 +1,307 @@
+
+#pragma once
+
+#include "mpi.hpp"
+#include "mpi/progress.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// \file threading.hpp
+/// \brief Point to point communication from many threads at any thread level
+
+namespace mpi
+{
+/// How the threads of a thread_communicator reach MPI
+enum class threading_path {
+    /// Each thread calls MPI directly on its own communicator
+    per_thread_communicators,
+    /// Threads queue operations for the thread that created the communicator
+    funnel
+};
+
+/// \return The fastest path that is safe with the thread support \p provided
+inline threading_path select_threading_path(thread const provided)
+{
+    return provided == thread::multiple ? threading_path::per_thread_communicators
+                                        : threading_path::funnel;
+}
+
+namespace detail
+{
+/// Completion state of an operation queued on the funnel path
+struct funnelled_operation
+{
+    std::atomic<bool> is_complete{false};
+    status result{};
+};
+}
+
+class thread_communicator;
+
+/// thread_request is the handle of an operation started through a
+/// thread_communicator
+class thread_request
+{
+public:
+    /// Wait for the operation to complete.  On the funnel path the thread that
+    /// created the communicator drives the queue while it waits.
+    status wait();
+
+    /// \return true if the operation has completed
+    bool test();
+
+private:
+    friend class thread_communicator;
+
+    thread_communicator* owner = nullptr;
+
+    /// Request of an operation started directly
+    request direct = MPI_REQUEST_NULL;
+    status direct_status{};
+    bool is_direct_complete = false;
+
+    std::shared_ptr<detail::funnelled_operation> funnelled;
+};
+
+/// thread_communicator lets a fixed number of threads on each process
+/// exchange messages with the threads of the same index on other processes,
+/// using the fastest path that is safe for the thread support of MPI.
+///
+/// With \p MPI_THREAD_MULTIPLE each thread calls MPI directly on its own
+/// duplicate of the communicator, so the threads never share a communicator
+/// and user tags need no encoding.  With less thread support every operation
+/// is pushed onto a lock-free queue and started by the thread that created
+/// the object (normally the main thread), which must call progress() or
+/// progress_until() while other threads communicate.  The messages of each
+/// thread are then kept apart by encoding the thread index in the tag, so
+/// user tags must be below tag_upper_bound() / thread_count and MPI_ANY_TAG
+/// cannot be used.  A larger tag or a thread index outside [0, thread_count)
+/// throws.
+///
+/// The same code runs on both paths.  Construction and destruction are
+/// collective and must happen on the creating thread.
+class thread_communicator
+{
+public:
+    /// Select the path from the thread support of MPI \sa select_threading_path
+    /// \param thread_count Number of threads that communicate on each process
+    /// \param comm MPI communicator
+    explicit thread_communicator(int const thread_count,
+                                 communicator const comm = communicator::world)
+        : thread_communicator(thread_count, select_threading_path(thread_level()), comm)
+    {
+    }
+
+    /// Use the given path, which is useful for comparing the two
+    thread_communicator(int const thread_count,
+                        threading_path const path,
+                        communicator const comm = communicator::world)
+        : thread_count(thread_count), selected_path(path), creator(std::this_thread::get_id())
+    {
+        if (path == threading_path::per_thread_communicators && thread_level() != thread::multiple)
+        {
+            throw std::runtime_error("mpi::thread_communicator: per thread communicators "
+                                     "require thread::multiple");
+        }
+
+        communicators.resize(path == threading_path::funnel ? 1 : thread_count);
+
+        for (auto& duplicate : communicators)
+        {
+            MPI_Comm_dup(comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+                         &duplicate);
+        }
+    }
+
+    thread_communicator(thread_communicator const&) = delete;
+    thread_communicator& operator=(thread_communicator const&) = delete;
+
+    /// All operations must have completed
+    ~thread_communicator()
+    {
+        for (auto& duplicate : communicators) MPI_Comm_free(&duplicate);
+    }
+
+    threading_path path() const { return selected_path; }
+
+    int threads() const { return thread_count; }
+
+    /// Start sending \p data, a built-in value or a contiguous vector of
+    /// built-in types, from thread \p thread_index to the thread of the same
+    /// index on \p destination_process
+    template <typename T>
+    thread_request send(int const thread_index,
+                        T const& data,
+                        int const destination_process,
+                        int const message_tag = 0)
+    {
+        auto const comm = communicator_of(thread_index);
+        auto const tag = tag_of(thread_index, message_tag);
+
+        return start([&data, destination_process, tag, comm] {
+            return mpi::send(async{}, data, destination_process, tag, comm);
+        });
+    }
+
+    /// Start receiving into \p data, sized to the message, on thread
+    /// \p thread_index from the thread of the same index on \p source_process
+    template <typename T>
+    thread_request receive(int const thread_index,
+                           T& data,
+                           int const source_process,
+                           int const message_tag = 0)
+    {
+        auto const comm = communicator_of(thread_index);
+        auto const tag = tag_of(thread_index, message_tag);
+
+        return start([&data, source_process, tag, comm] {
+            return mpi::receive(async{}, data, source_process, tag, comm);
+        });
+    }
+
+    /// Start the queued operations and complete the finished ones.  Only
+    /// called on the creating thread and does nothing on the per thread path.
+    void progress()
+    {
+        if (selected_path != threading_path::funnel) return;
+
+        for (auto& entry : queued.take_all()) operations.start(std::move(entry));
+
+        operations.test_some();
+    }
+
+    /// Call progress() until \p is_done returns true
+    template <typename Predicate>
+    void progress_until(Predicate&& is_done)
+    {
+        while (!is_done())
+        {
+            progress();
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    friend class thread_request;
+
+    MPI_Comm communicator_of(int const thread_index) const
+    {
+        if (thread_index < 0 || thread_index >= thread_count)
+        {
+            throw std::runtime_error("mpi::thread_communicator: thread index "
+                                     + std::to_string(thread_index) + " is outside [0, "
+                                     + std::to_string(thread_count) + ")");
+        }
+        return communicators[selected_path == threading_path::funnel ? 0 : thread_index];
+    }
+
+    int tag_of(int const thread_index, int const message_tag) const
+    {
+        // A wildcard would match the encoded tags of the other threads
+        if (selected_path == threading_path::funnel && message_tag == MPI_ANY_TAG)
+        {
+            throw std::runtime_error("mpi::thread_communicator: MPI_ANY_TAG is not supported "
+                                     "on the funnel path");
+        }
+        if (selected_path != threading_path::funnel) return message_tag;
+
+        if (message_tag > (tag_upper_bound() - thread_index) / thread_count)
+        {
+            throw std::runtime_error("mpi::thread_communicator: tag " + std::to_string(message_tag)
+                                     + " exceeds MPI_TAG_UB once encoded with the thread index");
+        }
+        return message_tag * thread_count + thread_index;
+    }
+
+    bool is_creator() const { return std::this_thread::get_id() == creator; }
+
+    template <typename Start_Tp>
+    thread_request start(Start_Tp&& start_operation)
+    {
+        thread_request handle;
+        handle.owner = this;
+
+        if (selected_path == threading_path::per_thread_communicators)
+        {
+            handle.direct = start_operation();
+            return handle;
+        }
+
+        auto state = std::make_shared<detail::funnelled_operation>();
+        handle.funnelled = state;
+
+        auto entry = std::make_unique<detail::submission>();
+        entry->start = std::forward<Start_Tp>(start_operation);
+        entry->complete = [state](status const& completed) {
+            state->result = completed;
+            state->is_complete.store(true, std::memory_order_release);
+        };
+        queued.push(std::move(entry));
+
+        return handle;
+    }
+
+private:
+    int thread_count;
+    threading_path selected_path;
+
+    /// The thread allowed to call MPI on the funnel path
+    std::thread::id creator;
+
+    /// One communicator per thread, or a single one on the funnel path
+    std::vector<MPI_Comm> communicators;
+
+    /// Operations waiting for the creating thread on the funnel path
+    detail::submission_queue queued;
+    detail::active_requests operations;
+};
+
+inline status thread_request::wait()
+{
+    if (!funnelled)
+    {
+        if (!is_direct_complete)
+        {
+            MPI_Wait(&direct, &direct_status);
+            is_direct_complete = true;
+        }
+        return direct_status;
+    }
+
+    while (!funnelled->is_complete.load(std::memory_order_acquire))
+    {
+        if (owner->is_creator())
+        {
+            owner->progress();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    return funnelled->result;
+}
+
+inline bool thread_request::test()
+{
+    if (!funnelled)
+    {
+        if (!is_direct_complete)
+        {
+            int flag = 0;
+            MPI_Test(&direct, &flag, &direct_status);
+            is_direct_complete = flag != 0;
+        }
+        return is_direct_complete;
+    }
+
+    if (owner->is_creator()) owner->progress();
+
+    return funnelled->is_complete.load(std::memory_order_acquire);
+}
+}
@@ -0,0 +1,228 @@
+
+#pragma once
+
+#include "mpi.hpp"
+
+#include <cstddef>
+#include <utility>
+
+/// \file window.hpp
+/// \brief Memory window for one-sided (RMA) communication
+
+namespace mpi
+{
+/// \class replace
+/// \brief \p MPI_REPLACE operation for atomic updates of a window
+struct replace
+{
+    MPI_Op const tag = MPI_REPLACE;
+};
+
+/// window is a block of memory allocated on every process in a communicator
+/// that other processes read and update without the participation of the
+/// owner.  Displacements are in bytes from the start of the target's block.
+///
+/// The window is opened for passive target access to all processes for its
+/// whole lifetime.  put(), get() and accumulate() are only guaranteed to have
+/// completed at the target after flush(), while the atomic operations
+/// returning a value complete before they return.  Concurrent updates of the
+/// same location must all be atomic operations, and each location should
+/// only be updated with a single operation besides replace and no-op.
+///
+/// Construction and destruction are collective.
+class window
+{
+public:
+    /// \param bytes Size of the local block
+    /// \param comm MPI communicator
+    explicit window(std::size_t const bytes, communicator const comm = communicator::world)
+    {
+        MPI_Win_allocate(bytes,
+                         1,
+                         MPI_INFO_NULL,
+                         comm == communicator::world ? MPI_COMM_WORLD : MPI_COMM_SELF,
+                         &base,
+                         &handle);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, handle);
+    }
+
+    window(window&& other) noexcept : handle(other.handle), base(other.base)
+    {
+        other.handle = MPI_WIN_NULL;
+    }
+
+    window& operator=(window&& other) noexcept
+    {
+        std::swap(handle, other.handle);
+        std::swap(base, other.base);
+        return *this;
+    }
+
+    window(window const&) = delete;
+    window& operator=(window const&) = delete;
+
+    ~window()
+    {
+        if (handle == MPI_WIN_NULL) return;
+
+        MPI_Win_unlock_all(handle);
+        MPI_Win_free(&handle);
+    }
+
+    /// \return The start of the local block
+    void* data() { return base; }
+
+    /// Atomically apply \p operation to the value at \p displacement on
+    /// \p target with \p operand
+    /// \return The value before the operation
+    template <typename T, typename Operation_Tp>
+    T fetch_and_op(T const operand,
+                   int const target,
+                   MPI_Aint const displacement,
+                   Operation_Tp&& operation)
+    {
+        return fetch_and_apply(operand, target, displacement, operation.tag);
+    }
+
+    /// Atomically read the value at \p displacement on \p target
+    template <typename T>
+    T load(int const target, MPI_Aint const displacement)
+    {
+        return fetch_and_apply(T{}, target, displacement, MPI_NO_OP);
+    }
+
+    /// Atomically replace the value at \p displacement on \p target
+    template <typename T>
+    void store(T const value, int const target, MPI_Aint const displacement)
+    {
+        fetch_and_apply(value, target, displacement, MPI_REPLACE);
+    }
+
+    /// Atomically replace the value at \p displacement on \p target with
+    /// \p desired if it equals \p expected
+    /// \return The value before the operation, equal to \p expected on success
+    template <typename T>
+    T compare_and_swap(T const desired,
+                       T const expected,
+                       int const target,
+                       MPI_Aint const displacement)
+    {
+        T previous;
+        MPI_Compare_and_swap(&desired,
+                             &expected,
+                             &previous,
+                             data_type<T>::value_type(),
+                             target,
+                             displacement,
+                             handle);
+        MPI_Win_flush(target, handle);
+        return previous;
+    }
+
+    /// Start an atomic read of the value at \p displacement on \p target into
+    /// \p value, which is valid after flush()
+    template <typename T>
+    void load(T& value, int const target, MPI_Aint const displacement)
+    {
+        MPI_Fetch_and_op(nullptr,
+                         &value,
+                         data_type<T>::value_type(),
+                         target,
+                         displacement,
+                         MPI_NO_OP,
+                         handle);
+    }
+
+    /// Start an atomic compare and swap, storing the value before the
+    /// operation in \p previous.  None of the arguments may be modified
+    /// before flush().
+    template <typename T>
+    void compare_and_swap(T const& desired,
+                          T const& expected,
+                          T& previous,
+                          int const target,
+                          MPI_Aint const displacement)
+    {
+        MPI_Compare_and_swap(&desired,
+                             &expected,
+                             &previous,
+                             data_type<T>::value_type(),
+                             target,
+                             displacement,
+                             handle);
+    }
+
+    /// Start an atomic update of the value at \p displacement on \p target
+    /// without fetching the previous value.  \p operand must not be modified
+    /// before flush().
+    template <typename T, typename Operation_Tp>
+    void accumulate(T const& operand,
+                    int const target,
+                    MPI_Aint const displacement,
+                    Operation_Tp&& operation)
+    {
+        MPI_Accumulate(&operand,
+                       1,
+                       data_type<T>::value_type(),
+                       target,
+                       displacement,
+                       1,
+                       data_type<T>::value_type(),
+                       operation.tag,
+                       handle);
+    }
+
+    /// Start copying \p bytes from \p source to \p displacement on \p target.
+    /// \p source must not be modified before flush().
+    void put(void const* source,
+             std::size_t const bytes,
+             int const target,
+             MPI_Aint const displacement)
+    {
+        MPI_Put(source, bytes, MPI_BYTE, target, displacement, bytes, MPI_BYTE, handle);
+    }
+
+    /// Start copying \p bytes from \p displacement on \p target to
+    /// \p destination, which is valid after flush()
+    void get(void* destination,
+             std::size_t const bytes,
+             int const target,
+             MPI_Aint const displacement)
+    {
+        MPI_Get(destination, bytes, MPI_BYTE, target, displacement, bytes, MPI_BYTE, handle);
+    }
+
+    /// Complete all operations started by this process on \p target
+    void flush(int const target) { MPI_Win_flush(target, handle); }
+
+    /// Complete all operations started by this process
+    void flush_all() { MPI_Win_flush_all(handle); }
+
+    /// Make stores to the local block through data() visible to other
+    /// processes.  Call before the barrier that publishes them.
+    void sync() { MPI_Win_sync(handle); }
+
+private:
+    template <typename T>
+    T fetch_and_apply(T const operand,
+                      int const target,
+                      MPI_Aint const displacement,
+                      MPI_Op const op)
+    {
+        T previous;
+        MPI_Fetch_and_op(&operand,
+                         &previous,
+                         data_type<T>::value_type(),
+                         target,
+                         displacement,
+                         op,
+                         handle);
+        MPI_Win_flush(target, handle);
+        return previous;
+    }
+
+private:
+    MPI_Win handle = MPI_WIN_NULL;
+    void* base = nullptr;
+};
+}
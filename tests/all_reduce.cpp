@@ -130,4 +130,50 @@ TEST_CASE("Reduction operations")
             }
         }
     }
+    SECTION("Reduced precision all reduce")
+    {
+        std::vector<double> vec{{1.5, 0.25, -2.0, 1.0e3}};
+
+        auto const half_sum = mpi::all_reduce(mpi::reduced_precision<mpi::half>{}, vec, mpi::sum{});
+
+        REQUIRE(half_sum.size() == vec.size());
+        REQUIRE(half_sum.at(0) == 1.5 * mpi::size());
+        REQUIRE(half_sum.at(1) == 0.25 * mpi::size());
+        REQUIRE(half_sum.at(2) == -2.0 * mpi::size());
+        REQUIRE(half_sum.at(3) == 1.0e3 * mpi::size());
+
+        std::vector<float> ranks(3, static_cast<float>(mpi::rank()) + 0.1f);
+
+        for (auto const value :
+             mpi::all_reduce(mpi::reduced_precision<mpi::bfloat16>{}, ranks, mpi::max{}))
+        {
+            REQUIRE(value == Approx(mpi::size() - 1 + 0.1f).epsilon(1.0e-2));
+        }
+        for (auto const value :
+             mpi::all_reduce(mpi::reduced_precision<mpi::bfloat16>{}, ranks, mpi::min{}))
+        {
+            REQUIRE(value == Approx(0.1f).epsilon(1.0e-2));
+        }
+    }
+    SECTION("Reduced precision all to all")
+    {
+        std::vector<float> blocks(2 * mpi::size(), static_cast<float>(mpi::rank()));
+
+        auto const collected = mpi::all_to_all(mpi::reduced_precision<mpi::half>{}, blocks);
+
+        REQUIRE(collected.size() == blocks.size());
+        for (int process = 0; process < mpi::size(); ++process)
+        {
+            REQUIRE(collected.at(2 * process) == process);
+            REQUIRE(collected.at(2 * process + 1) == process);
+        }
+
+        // Every length splits evenly over a single process
+        if (mpi::size() > 1)
+        {
+            blocks.push_back(0.0f);
+            REQUIRE_THROWS_AS(mpi::all_to_all(mpi::reduced_precision<mpi::half>{}, blocks),
+                              std::runtime_error);
+        }
+    }
 }
@@ -45,4 +45,16 @@ TEST_CASE("Broadcast communication")
             REQUIRE(bcast.at(1) == 2);
         }
     }
+    SECTION("Reduced precision vector")
+    {
+        std::vector<double> bcast_vector(3, 0.0);
+
+        if (mpi::rank() == 0) bcast_vector = {1.0, -0.5, 3.14159};
+
+        auto const bcast = mpi::broadcast(mpi::reduced_precision<mpi::bfloat16>{}, bcast_vector);
+
+        REQUIRE(bcast.at(0) == 1.0);
+        REQUIRE(bcast.at(1) == -0.5);
+        REQUIRE(bcast.at(2) == Approx(3.14159).epsilon(1.0e-2));
+    }
 }
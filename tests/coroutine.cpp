@@ -0,0 +1,107 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/coroutine.hpp"
+
+#include <numeric>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+/// Exchange a vector with the neighbouring processes, written sequentially
+mpi::task<int> exchange(mpi::scheduler& scheduler, int const tag)
+{
+    auto const next = (mpi::rank() + 1) % mpi::size();
+    auto const previous = (mpi::rank() + mpi::size() - 1) % mpi::size();
+
+    std::vector<int> outgoing(1000, 10 * mpi::rank() + tag);
+    std::vector<int> incoming(1000, -1);
+
+    auto receive = scheduler.receive(incoming, previous, tag);
+    co_await scheduler.send(outgoing, next, tag);
+    auto const received = co_await receive;
+
+    REQUIRE(received.MPI_SOURCE == previous);
+    REQUIRE(received.MPI_TAG == tag);
+
+    co_return std::accumulate(begin(incoming), end(incoming), 0);
+}
+
+TEST_CASE("Coroutine point to point")
+{
+    auto const previous = (mpi::rank() + mpi::size() - 1) % mpi::size();
+
+    mpi::scheduler scheduler;
+
+    std::vector<int> sums(8, 0);
+
+    for (int tag = 0; tag < 8; ++tag)
+    {
+        scheduler.spawn([](mpi::scheduler& scheduler, int& sum, int tag) -> mpi::task<> {
+            sum = co_await exchange(scheduler, tag);
+        }(scheduler, sums[tag], tag));
+    }
+    scheduler.run();
+
+    for (int tag = 0; tag < 8; ++tag)
+    {
+        REQUIRE(sums[tag] == 1000 * (10 * previous + tag));
+    }
+}
+
+TEST_CASE("Coroutine collectives")
+{
+    mpi::scheduler scheduler;
+
+    scheduler.spawn([](mpi::scheduler& scheduler) -> mpi::task<> {
+        auto const total = co_await scheduler.all_reduce(mpi::rank() + 1, mpi::sum{});
+        REQUIRE(total == mpi::size() * (mpi::size() + 1) / 2);
+
+        std::vector<double> values(3, static_cast<double>(mpi::rank()));
+        auto const largest = co_await scheduler.all_reduce(values, mpi::max{});
+        REQUIRE(largest == std::vector<double>(3, mpi::size() - 1.0));
+
+        auto const broadcast = co_await scheduler.broadcast(mpi::rank() == 0 ? 42 : 0);
+        REQUIRE(broadcast == 42);
+
+        co_await scheduler.barrier();
+    }(scheduler));
+
+    scheduler.run();
+}
+
+TEST_CASE("Coroutine exceptions")
+{
+    mpi::scheduler scheduler;
+
+    scheduler.spawn([](mpi::scheduler& scheduler) -> mpi::task<> {
+        co_await scheduler.barrier();
+        throw std::runtime_error("failed after the barrier");
+    }(scheduler));
+
+    REQUIRE_THROWS_AS(scheduler.run(), std::runtime_error);
+}
@@ -0,0 +1,159 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/distributed_vector.hpp"
+
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+TEST_CASE("Partition index mapping")
+{
+    SECTION("Block")
+    {
+        mpi::partition layout(10, 3, mpi::block{});
+
+        REQUIRE(layout.local_size(0) == 4);
+        REQUIRE(layout.local_size(1) == 3);
+        REQUIRE(layout.local_size(2) == 3);
+
+        REQUIRE(layout.owner(3) == 0);
+        REQUIRE(layout.owner(4) == 1);
+        REQUIRE(layout.owner(9) == 2);
+        REQUIRE(layout.local_index(8) == 1);
+
+        for (std::size_t index = 0; index < layout.global_size(); ++index)
+        {
+            REQUIRE(layout.global_index(layout.owner(index), layout.local_index(index)) == index);
+        }
+    }
+    SECTION("Block cyclic")
+    {
+        mpi::partition layout(11, 2, mpi::block_cyclic{2});
+
+        // Blocks {0, 1} {4, 5} {8, 9} on process 0 and {2, 3} {6, 7} {10} on process 1
+        REQUIRE(layout.local_size(0) == 6);
+        REQUIRE(layout.local_size(1) == 5);
+
+        REQUIRE(layout.owner(5) == 0);
+        REQUIRE(layout.owner(10) == 1);
+        REQUIRE(layout.local_index(9) == 5);
+        REQUIRE(layout.local_index(6) == 2);
+
+        for (std::size_t index = 0; index < layout.global_size(); ++index)
+        {
+            REQUIRE(layout.global_index(layout.owner(index), layout.local_index(index)) == index);
+        }
+    }
+    SECTION("Fewer entries than processes")
+    {
+        mpi::partition layout(2, 4, mpi::block{});
+
+        REQUIRE(layout.owner(1) == 1);
+        REQUIRE(layout.local_size(3) == 0);
+
+        REQUIRE_THROWS_AS(layout.owner(2), std::runtime_error);
+        REQUIRE_THROWS_AS(layout.local_index(2), std::runtime_error);
+
+        mpi::partition cyclic(11, 2, mpi::block_cyclic{2});
+        REQUIRE_THROWS_AS(cyclic.local_index(11), std::runtime_error);
+    }
+}
+
+TEST_CASE("Distributed vector")
+{
+    std::size_t const global_size = 101;
+
+    SECTION("Reductions")
+    {
+        mpi::distributed_vector<double> x(global_size, 2.0);
+
+        REQUIRE(mpi::all_reduce(static_cast<int>(x.local_size()), mpi::sum{}) == global_size);
+
+        std::iota(x.begin(), x.end(), static_cast<double>(x.global_index(0)));
+
+        REQUIRE(mpi::sum_of(x) == Approx(global_size * (global_size - 1) / 2.0));
+        REQUIRE(mpi::max_of(x) == Approx(global_size - 1.0));
+        REQUIRE(mpi::min_of(x) == Approx(0.0));
+
+        mpi::distributed_vector<double> ones(global_size, 1.0);
+
+        REQUIRE(mpi::dot(x, ones) == Approx(mpi::sum_of(x)));
+        REQUIRE(mpi::norm(ones) == Approx(std::sqrt(static_cast<double>(global_size))));
+
+        // An integer value is converted instead of being taken as a partition
+        mpi::distributed_vector<double> zeros(global_size, 0);
+
+        REQUIRE(mpi::max_of(zeros) == 0.0);
+    }
+    SECTION("Ghost update for a periodic stencil")
+    {
+        auto const check_stencil = [&](mpi::distributed_vector<int>& x) {
+            std::vector<std::size_t> neighbours;
+            for (std::size_t local = 0; local < x.local_size(); ++local)
+            {
+                auto const index = x.global_index(local);
+                neighbours.push_back((index + global_size - 1) % global_size);
+                neighbours.push_back((index + 1) % global_size);
+            }
+            x.set_ghosts(neighbours);
+
+            REQUIRE(x.ghost_size() > 0);
+
+            // The plan is reused for each update
+            for (int step = 1; step <= 3; ++step)
+            {
+                for (std::size_t local = 0; local < x.local_size(); ++local)
+                {
+                    x[local] = step * static_cast<int>(x.global_index(local));
+                }
+
+                x.update_ghosts();
+
+                for (auto const index : neighbours)
+                {
+                    REQUIRE(x.global(index) == step * static_cast<int>(index));
+                }
+            }
+        };
+
+        mpi::distributed_vector<int> block_vector(global_size);
+        check_stencil(block_vector);
+
+        mpi::distributed_vector<int> cyclic_vector(global_size, mpi::block_cyclic{3});
+        check_stencil(cyclic_vector);
+    }    SECTION("Ghost index outside the vector")
+    {
+        mpi::distributed_vector<int> x(global_size);
+
+        REQUIRE_THROWS_AS(x.set_ghosts({0, global_size}), std::runtime_error);
+        REQUIRE(x.ghost_size() == 0);
+    }
+}
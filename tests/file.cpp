@@ -0,0 +1,199 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/file.hpp"
+
+#include <complex>
+#include <numeric>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+struct particle
+{
+    int id;
+    double mass;
+};
+
+TEST_CASE("Collective file operations")
+{
+    std::string const filename = "mpi_file_test.dat";
+
+    constexpr auto local_size = 4;
+
+    SECTION("Vector write and read at offsets")
+    {
+        std::vector<double> local_data(local_size);
+        std::iota(begin(local_data), end(local_data), mpi::rank() * local_size);
+
+        MPI_Offset const offset = mpi::rank() * local_size * sizeof(double);
+        {
+            mpi::file output(filename, mpi::file_mode::write);
+            output.write_at_all(offset, local_data);
+        }
+        {
+            mpi::file input(filename, mpi::file_mode::read);
+
+            REQUIRE(input.size()
+                    == static_cast<MPI_Offset>(mpi::size() * local_size * sizeof(double)));
+
+            // Read the block of the next process to check the global ordering
+            auto const neighbour = (mpi::rank() + 1) % mpi::size();
+
+            auto const data = input.read_at_all<std::vector<double>>(neighbour * local_size
+                                                                         * sizeof(double),
+                                                                     local_size);
+            for (auto i = 0; i < local_size; ++i)
+            {
+                REQUIRE(data.at(i) == neighbour * local_size + i);
+            }
+        }
+    }
+    SECTION("Nonblocking write with hints")
+    {
+        mpi::file_hints hints;
+        hints.collective_write = mpi::buffering::enable;
+        hints.buffer_size = 1 << 20;
+        hints.aggregators = 1;
+
+        std::vector<int> local_data(local_size, mpi::rank());
+        {
+            mpi::file output(filename, mpi::file_mode::read_write, hints);
+
+            auto const request = output.iwrite_at_all(mpi::rank() * local_size * sizeof(int),
+                                                      local_data);
+
+            // Computation happens here
+
+            mpi::wait(request);
+
+            // Make the data written by the other processes visible
+            output.sync();
+            mpi::barrier();
+            output.sync();
+
+            auto const data = output.read_at_all<std::vector<int>>(0, mpi::size() * local_size);
+
+            for (auto i = 0; i < mpi::size() * local_size; ++i)
+            {
+                REQUIRE(data.at(i) == i / local_size);
+            }
+        }
+    }
+    SECTION("Subarray of a global grid")
+    {
+        // Each process owns a column block of a 2 x (2 * size) row major grid
+        auto const layout = mpi::make_subarray<double>({2, 2 * mpi::size()},
+                                                       {2, 2},
+                                                       {0, 2 * mpi::rank()});
+
+        std::vector<double> block(4, static_cast<double>(mpi::rank()));
+        {
+            mpi::file output(filename, mpi::file_mode::write);
+
+            mpi::wait(output.iwrite_all(layout, block));
+        }
+        {
+            mpi::file input(filename, mpi::file_mode::read);
+
+            REQUIRE(input.read_all<std::vector<double>>(layout, 4) == block);
+
+            auto const grid = input.read_at_all<std::vector<double>>(0, 4 * mpi::size());
+
+            for (auto row = 0; row < 2; ++row)
+            {
+                for (auto column = 0; column < 2 * mpi::size(); ++column)
+                {
+                    REQUIRE(grid.at(row * 2 * mpi::size() + column) == column / 2);
+                }
+            }
+        }
+    }
+    SECTION("Rewrite with less data")
+    {
+        {
+            mpi::file output(filename, mpi::file_mode::write);
+            output.write_at_all(mpi::rank() * local_size * sizeof(double),
+                                std::vector<double>(local_size, 1.0));
+        }
+        {
+            mpi::file output(filename, mpi::file_mode::write);
+            output.write_at_all(mpi::rank() * sizeof(double),
+                                std::vector<double>(1, mpi::rank()));
+        }
+        {
+            mpi::file input(filename, mpi::file_mode::read);
+
+            REQUIRE(input.size() == static_cast<MPI_Offset>(mpi::size() * sizeof(double)));
+        }
+    }
+    SECTION("Complex values")
+    {
+        std::vector<std::complex<double>> local_data{{1.0 * mpi::rank(), -1.0},
+                                                     {0.5, 2.0 * mpi::rank()}};
+
+        MPI_Offset const offset = mpi::rank() * local_data.size() * sizeof(std::complex<double>);
+        {
+            mpi::file output(filename, mpi::file_mode::write);
+            mpi::wait(output.iwrite_at_all(offset, local_data));
+        }
+        {
+            mpi::file input(filename, mpi::file_mode::read);
+
+            auto const data = input.read_at_all<std::vector<std::complex<double>>>(offset, 2);
+
+            REQUIRE(data == local_data);
+        }
+    }
+    SECTION("Vector of structures")
+    {
+        auto const particle_type = mpi::make_struct(&particle::id, &particle::mass);
+
+        std::vector<particle> particles{{mpi::rank(), 1.5 * mpi::rank()}};
+        {
+            mpi::file output(filename, mpi::file_mode::write);
+            output.write_at_all(mpi::rank() * particle_type.size(), particles, particle_type);
+        }
+        {
+            mpi::file input(filename, mpi::file_mode::read);
+
+            auto const all_particles = input.read_at_all<std::vector<particle>>(0,
+                                                                               mpi::size(),
+                                                                               particle_type);
+            for (auto i = 0; i < mpi::size(); ++i)
+            {
+                REQUIRE(all_particles.at(i).id == i);
+                REQUIRE(all_particles.at(i).mass == 1.5 * i);
+            }
+        }
+    }
+    mpi::barrier();
+
+    if (mpi::rank() == 0) mpi::remove_file(filename);
+
+    mpi::barrier();
+}
@@ -2,6 +2,7 @@
 #define CATCH_CONFIG_RUNNER
 
 #include <catch.hpp>
+#include <stdexcept>
 #include <vector>
 
 #include "mpi.hpp"
@@ -52,4 +53,80 @@ TEST_CASE("Gather operations")
             REQUIRE(result.at(3) == 1);
         }
     }
+    SECTION("Scalar all gather")
+    {
+        auto const ranks = mpi::all_gather(mpi::rank());
+
+        REQUIRE(ranks.size() == static_cast<std::size_t>(mpi::size()));
+        for (auto i = 0; i < mpi::size(); ++i)
+        {
+            REQUIRE(ranks.at(i) == i);
+        }
+    }
+    SECTION("Variable size all gather")
+    {
+        // Process i contributes i + 1 copies of its rank
+        std::vector<double> gather_vector(mpi::rank() + 1, mpi::rank());
+
+        auto const result = mpi::all_gather(gather_vector);
+
+        std::vector<double> expected;
+        for (auto process = 0; process < mpi::size(); ++process)
+        {
+            expected.insert(end(expected), process + 1, process);
+        }
+        REQUIRE(result == expected);
+    }
+    SECTION("All to all")
+    {
+        // Block d of process r holds {r, d} and is sent to process d
+        std::vector<int> blocks(2 * mpi::size());
+        for (auto process = 0; process < mpi::size(); ++process)
+        {
+            blocks[2 * process] = mpi::rank();
+            blocks[2 * process + 1] = process;
+        }
+
+        auto const collected = mpi::all_to_all(blocks);
+
+        REQUIRE(collected.size() == blocks.size());
+        for (auto process = 0; process < mpi::size(); ++process)
+        {
+            REQUIRE(collected.at(2 * process) == process);
+            REQUIRE(collected.at(2 * process + 1) == mpi::rank());
+        }
+
+        // Every length splits evenly over a single process
+        if (mpi::size() > 1)
+        {
+            blocks.push_back(0);
+            REQUIRE_THROWS_AS(mpi::all_to_all(blocks), std::runtime_error);
+        }
+    }
+    SECTION("Variable size all to all")
+    {
+        // Process r sends (r + d) % 3 copies of 100 r + d to process d, so
+        // some pairs of processes exchange nothing
+        auto const count_of = [](int const source, int const destination) {
+            return (source + destination) % 3;
+        };
+
+        std::vector<int> local_data, send_counts;
+        for (auto process = 0; process < mpi::size(); ++process)
+        {
+            send_counts.push_back(count_of(mpi::rank(), process));
+            local_data.insert(end(local_data), send_counts.back(), 100 * mpi::rank() + process);
+        }
+
+        auto const result = mpi::all_to_allv(local_data, send_counts);
+
+        std::vector<int> expected;
+        for (auto process = 0; process < mpi::size(); ++process)
+        {
+            expected.insert(end(expected),
+                            count_of(process, mpi::rank()),
+                            100 * process + mpi::rank());
+        }
+        REQUIRE(result == expected);
+    }
 }
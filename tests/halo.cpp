@@ -0,0 +1,182 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/halo.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+namespace
+{
+/// Value of a global cell before the first step
+double initial_value(int const cell) { return (cell * cell) % 7; }
+}
+
+TEST_CASE("Halo exchange")
+{
+    auto const cells = 16;
+    auto const global_cells = cells * mpi::size();
+
+    auto const offset = cells * mpi::rank();
+
+    auto const previous = (mpi::rank() + mpi::size() - 1) % mpi::size();
+    auto const next = (mpi::rank() + 1) % mpi::size();
+
+    SECTION("Periodic stencil")
+    {
+        // Local cells with a ghost cell at each end
+        std::vector<double> values(cells + 2), updated(cells + 2);
+        for (int cell = 0; cell < cells; ++cell) values[cell + 1] = initial_value(offset + cell);
+
+        std::vector<double> to_previous(1), from_previous(1), to_next(1), from_next(1);
+
+        auto const update = [&](int const cell) {
+            updated[cell] = values[cell - 1] + values[cell] + values[cell + 1];
+        };
+
+        mpi::halo_exchange halo;
+
+        // Messages travelling down are tagged 0 and up 1, so the regions stay
+        // apart when both neighbours are the same process
+        halo.add_region(previous,
+                        to_previous,
+                        from_previous,
+                        [&] {
+                            values.front() = from_previous.front();
+                            update(1);
+                        },
+                        0,
+                        1);
+        halo.add_region(next,
+                        to_next,
+                        from_next,
+                        [&] {
+                            values.back() = from_next.front();
+                            update(cells);
+                        },
+                        1,
+                        0);
+
+        REQUIRE(halo.size() == 2);
+
+        // Serial reference of the whole domain
+        std::vector<double> reference(global_cells), stepped(global_cells);
+        for (int cell = 0; cell < global_cells; ++cell) reference[cell] = initial_value(cell);
+
+        auto const steps = 5;
+
+        for (int step = 0; step < steps; ++step)
+        {
+            to_previous.front() = values[1];
+            to_next.front() = values[cells];
+
+            halo.exchange([&] {
+                for (int cell = 2; cell < cells; ++cell) update(cell);
+            });
+            std::swap(values, updated);
+
+            for (int cell = 0; cell < global_cells; ++cell)
+            {
+                stepped[cell] = reference[(cell + global_cells - 1) % global_cells]
+                                + reference[cell] + reference[(cell + 1) % global_cells];
+            }
+            std::swap(reference, stepped);
+        }
+
+        for (int cell = 0; cell < cells; ++cell)
+        {
+            REQUIRE(values[cell + 1] == reference[offset + cell]);
+        }
+
+        auto const& timers = halo.timers();
+
+        REQUIRE(timers.exchanges == steps);
+        REQUIRE(timers.post >= 0.0);
+        REQUIRE(timers.interior >= 0.0);
+        REQUIRE(timers.receive_wait >= 0.0);
+        REQUIRE(timers.boundary >= 0.0);
+        REQUIRE(timers.send_wait >= 0.0);
+
+        halo.reset_timers();
+        REQUIRE(halo.timers().exchanges == 0);
+    }
+    SECTION("Physical boundaries")
+    {
+        auto const lower = mpi::rank() == 0 ? MPI_PROC_NULL : previous;
+        auto const upper = mpi::rank() == mpi::size() - 1 ? MPI_PROC_NULL : next;
+
+        int to_lower = mpi::rank(), to_upper = mpi::rank();
+        int from_lower = -1, from_upper = -1;
+
+        int boundaries_run = 0, interior_run = 0;
+
+        mpi::halo_exchange halo;
+
+        halo.add_region(lower, to_lower, from_lower, [&] { ++boundaries_run; }, 0, 1);
+        halo.add_region(upper, to_upper, from_upper, [&] { ++boundaries_run; }, 1, 0);
+
+        halo.exchange([&] { ++interior_run; });
+
+        REQUIRE(interior_run == 1);
+        REQUIRE(boundaries_run == 2);
+
+        REQUIRE(from_lower == (lower == MPI_PROC_NULL ? -1 : lower));
+        REQUIRE(from_upper == (upper == MPI_PROC_NULL ? -1 : upper));
+    }    SECTION("Throwing boundary kernel")
+    {
+        int to_previous = mpi::rank(), to_next = mpi::rank();
+        int from_previous = -1, from_next = -1;
+
+        bool should_throw = true;
+
+        mpi::halo_exchange halo;
+
+        halo.add_region(previous,
+                        to_previous,
+                        from_previous,
+                        [&] {
+                            if (should_throw) throw std::runtime_error("boundary failure");
+                        },
+                        0,
+                        1);
+        halo.add_region(next, to_next, from_next, [] {}, 1, 0);
+
+        REQUIRE_THROWS_AS(halo.exchange([] {}), std::runtime_error);
+
+        // Every message of the failed exchange has completed, so the next
+        // exchange matches its own messages
+        should_throw = false;
+        to_previous = to_next = 10 + mpi::rank();
+
+        halo.exchange([] {});
+
+        REQUIRE(from_previous == 10 + previous);
+        REQUIRE(from_next == 10 + next);
+    }
+}
@@ -0,0 +1,175 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/hash_map.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv, mpi::thread::multiple);
+
+    return session.run();
+}
+
+/// Value too large to be stored in the window
+struct large_value
+{
+    long long key;
+    char padding[1000];
+};
+
+/// Insert keys owned by this process and keys shared by all processes, then
+/// look up the keys inserted by every process
+template <typename Map_Tp, typename Make_Value>
+void check_insert_and_find(Map_Tp& map, Make_Value make_value)
+{
+    long long const shared_keys = 200, keys_per_process = 1000;
+
+    std::vector<long long> keys;
+    for (long long key = 0; key < shared_keys; ++key) keys.push_back(key);
+    for (long long entry = 0; entry < keys_per_process; ++entry)
+    {
+        keys.push_back(10000 + mpi::rank() * keys_per_process + entry);
+    }
+
+    std::vector<decltype(make_value(0))> values;
+    for (auto const key : keys) values.push_back(make_value(key));
+
+    auto const inserted = map.insert(keys, values);
+
+    int shared_inserted = std::count(begin(inserted), begin(inserted) + shared_keys, true);
+
+    REQUIRE(std::all_of(begin(inserted) + shared_keys, end(inserted), [](bool b) { return b; }));
+    REQUIRE(mpi::all_reduce(shared_inserted, mpi::sum{}) == shared_keys);
+
+    // Inserting again finds every key present
+    auto const reinserted = map.insert(keys, values);
+    REQUIRE(std::none_of(begin(reinserted), end(reinserted), [](bool b) { return b; }));
+
+    std::vector<long long> other_keys;
+    auto const other = (mpi::rank() + 1) % mpi::size();
+    for (long long entry = 0; entry < keys_per_process; ++entry)
+    {
+        other_keys.push_back(10000 + other * keys_per_process + entry);
+    }
+    other_keys.push_back(-1);
+
+    auto const results = map.find(other_keys);
+
+    for (std::size_t entry = 0; entry + 1 < other_keys.size(); ++entry)
+    {
+        REQUIRE(results[entry].found);
+        REQUIRE(results[entry].value.key == other_keys[entry]);
+    }
+    REQUIRE_FALSE(results.back().found);
+
+    REQUIRE(map.find(keys.front()).found);
+
+    // Start insertions of new keys and lookups of the inserted keys together
+    // and complete them later
+    std::vector<long long> later_keys;
+    for (long long entry = 0; entry < keys_per_process; ++entry)
+    {
+        later_keys.push_back(20000 + mpi::rank() * keys_per_process + entry);
+    }
+
+    std::vector<decltype(make_value(0))> later_values;
+    for (auto const key : later_keys) later_values.push_back(make_value(key));
+
+    auto insertion = map.insert(mpi::async{}, later_keys, later_values);
+    auto lookups = map.find(mpi::async{}, keys);
+
+    auto const later_inserted = insertion.wait();
+    REQUIRE(std::all_of(begin(later_inserted), end(later_inserted), [](bool b) { return b; }));
+
+    auto const found = lookups.wait();
+    for (std::size_t entry = 0; entry < keys.size(); ++entry)
+    {
+        REQUIRE(found[entry].found);
+        REQUIRE(found[entry].value.key == keys[entry]);
+    }
+
+    auto const later_found = map.find(mpi::async{}, later_keys).wait();
+    REQUIRE(std::all_of(begin(later_found),
+                        end(later_found),
+                        [](mpi::lookup<decltype(make_value(0))> const& r) { return r.found; }));
+
+    // A completed batch cannot be waited on again
+    REQUIRE_THROWS_AS(lookups.wait(), std::runtime_error);
+}
+
+struct small_value
+{
+    long long key;
+    int rank;
+};
+
+TEST_CASE("Distributed hash map")
+{
+    SECTION("One-sided storage of small values")
+    {
+        mpi::distributed_hash_map<long long, small_value> map(4096);
+
+        REQUIRE(map.is_one_sided());
+
+        check_insert_and_find(map, [](long long key) { return small_value{key, mpi::rank()}; });
+    }
+    SECTION("Messages for large values")
+    {
+        mpi::distributed_hash_map<long long, large_value> map(4096);
+
+        // Messages are answered by a service thread, which needs thread::multiple
+        REQUIRE(map.is_one_sided() == (mpi::thread_level() != mpi::thread::multiple));
+
+        check_insert_and_find(map, [](long long key) { return large_value{key, {}}; });
+    }
+    SECTION("Full table")
+    {
+        mpi::distributed_hash_map<int, int> map(4);
+
+        if (mpi::rank() == 0)
+        {
+            std::vector<int> keys(100);
+            std::iota(begin(keys), end(keys), 0);
+
+            REQUIRE_THROWS_AS(map.insert(keys, keys), std::runtime_error);
+
+            // Slots left claimed would make the lookups probe them forever
+            auto const results = map.find(keys);
+
+            auto const found = std::count_if(begin(results),
+                                             end(results),
+                                             [](mpi::lookup<int> const& r) { return r.found; });
+            REQUIRE(found >= 4);
+            REQUIRE(found <= 4 * mpi::size());
+
+            for (std::size_t index = 0; index < keys.size(); ++index)
+            {
+                if (results[index].found) REQUIRE(results[index].value == keys[index]);
+            }
+        }
+    }
+}
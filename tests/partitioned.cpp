@@ -0,0 +1,128 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/partitioned.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv, mpi::thread::multiple);
+
+    return session.run();
+}
+
+/// Threads fill the partitions of a buffer sent to the next process and check
+/// the partitions received from the previous process as they arrive
+void exchange_partitions(mpi::threading_path const path)
+{
+    int const partitions = 4, partition_size = 1000;
+
+    auto const next = (mpi::rank() + 1) % mpi::size();
+    auto const previous = (mpi::rank() + mpi::size() - 1) % mpi::size();
+
+    std::vector<double> outgoing(partitions * partition_size), incoming(outgoing.size());
+
+    mpi::partitioned_send<std::vector<double>> sender(outgoing, partitions, next, 3, path);
+    mpi::partitioned_receive<std::vector<double>> receiver(incoming, partitions, previous, 3, path);
+
+    REQUIRE(sender.partitions() == partitions);
+    REQUIRE(receiver.path() == path);
+
+    // The persistent requests are reused for every transfer
+    for (int transfer = 0; transfer < 3; ++transfer)
+    {
+        receiver.start();
+        sender.start();
+
+        std::vector<int> correct(partitions, 0);
+
+        auto const fill_and_check = [&](int const partition) {
+            std::fill(begin(outgoing) + partition * partition_size,
+                      begin(outgoing) + (partition + 1) * partition_size,
+                      1000.0 * transfer + 10.0 * mpi::rank() + partition);
+
+            sender.ready(partition);
+
+            while (!receiver.arrived(partition)) std::this_thread::yield();
+
+            correct[partition] = std::all_of(begin(incoming) + partition * partition_size,
+                                             begin(incoming) + (partition + 1) * partition_size,
+                                             [&](double value) {
+                                                 return value
+                                                        == 1000.0 * transfer + 10.0 * previous
+                                                               + partition;
+                                             });
+        };
+
+        std::vector<std::thread> workers;
+        for (int partition = partitions - 1; partition > 0; --partition)
+        {
+            workers.emplace_back(fill_and_check, partition);
+        }
+
+        // The creating thread takes part like the main thread of a parallel region
+        fill_and_check(0);
+
+        sender.wait();
+        receiver.wait();
+
+        for (auto& worker : workers) worker.join();
+
+        REQUIRE(std::all_of(begin(correct), end(correct), [](int c) { return c == 1; }));
+    }
+}
+
+TEST_CASE("Partitioned communication")
+{
+    SECTION("Funnel") { exchange_partitions(mpi::threading_path::funnel); }
+    if (mpi::thread_level() == mpi::thread::multiple)
+    {
+        SECTION("Per thread calls")
+        {
+            exchange_partitions(mpi::threading_path::per_thread_communicators);
+        }
+    }
+    SECTION("Unequal partitions")
+    {
+        std::vector<int> buffer(10);
+        REQUIRE_THROWS_AS(mpi::partitioned_send<std::vector<int>>(buffer, 3, 0),
+                          std::runtime_error);
+    }
+    if (!mpi::detail::has_native_partitioned)
+    {
+        SECTION("Tag too large to encode the partition")
+        {
+            std::vector<int> buffer(10);
+
+            auto const tag = mpi::tag_upper_bound() / 5 + 1;
+
+            REQUIRE_THROWS_AS(mpi::partitioned_send<std::vector<int>>(buffer, 5, 0, tag),
+                              std::runtime_error);
+            REQUIRE_THROWS_AS(mpi::partitioned_receive<std::vector<int>>(buffer, 5, 0, tag),
+                              std::runtime_error);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/progress.hpp"
+
+#include <atomic>
+#include <future>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv, mpi::thread::multiple);
+
+    return session.run();
+}
+
+TEST_CASE("Progress engine")
+{
+    auto const partner = (mpi::rank() + 1) % mpi::size();
+    auto const previous = (mpi::rank() + mpi::size() - 1) % mpi::size();
+
+    SECTION("Submissions from many threads")
+    {
+        mpi::progress_engine engine;
+
+        int const thread_count = 4;
+
+        std::vector<std::thread> workers;
+        std::vector<int> correct(thread_count, 0);
+
+        for (int thread = 0; thread < thread_count; ++thread)
+        {
+            workers.emplace_back([&, thread] {
+                std::vector<double> outgoing(1000, 10.0 * mpi::rank() + thread);
+                std::vector<double> incoming(1000, -1.0);
+
+                auto received = engine.receive(incoming, previous, thread);
+                auto sent = engine.send(outgoing, partner, thread);
+
+                auto const receive_status = received.get();
+                sent.wait();
+
+                correct[thread] = receive_status.MPI_SOURCE == previous
+                                  && std::all_of(begin(incoming), end(incoming), [&](double v) {
+                                         return v == 10.0 * previous + thread;
+                                     });
+            });
+        }
+        for (auto& worker : workers) worker.join();
+
+        REQUIRE(std::all_of(begin(correct), end(correct), [](int c) { return c == 1; }));
+        REQUIRE(engine.completed() == 2 * thread_count);
+    }
+    SECTION("Large transfer overlapped with computation")
+    {
+        mpi::progress_engine engine;
+
+        std::vector<double> outgoing(1 << 22, static_cast<double>(mpi::rank()));
+        std::vector<double> incoming(outgoing.size());
+
+        std::atomic<int> callbacks{0};
+
+        engine.submit([&] { return mpi::receive(mpi::async{}, incoming, previous, 7); },
+                      [&](mpi::status const&) { ++callbacks; });
+        auto sent = engine.send(outgoing, partner, 7);
+
+        // Work on the calling thread while the engine moves the data
+        std::vector<double> work(1 << 20);
+        std::iota(begin(work), end(work), 0.0);
+        auto const total = std::accumulate(begin(work), end(work), 0.0);
+
+        sent.wait();
+        while (callbacks.load() == 0) std::this_thread::yield();
+
+        REQUIRE(total > 0.0);
+        REQUIRE(incoming.front() == static_cast<double>(previous));
+        REQUIRE(incoming.back() == static_cast<double>(previous));
+    }
+    SECTION("Scalars")
+    {
+        mpi::progress_engine engine;
+
+        int value = mpi::rank(), received = -1;
+
+        auto receive_done = engine.receive(received, previous, 3);
+        engine.send(value, partner, 3).wait();
+        receive_done.wait();
+
+        REQUIRE(received == previous);
+    }
+    SECTION("Temporaries")
+    {
+        mpi::progress_engine engine;
+
+        std::vector<double> incoming(1000);
+        int value = -1;
+
+        auto received = engine.receive(incoming, previous, 5);
+        auto value_received = engine.receive(value, previous, 6);
+
+        // The temporaries are kept alive by the engine until the sends complete
+        auto sent = engine.send(std::vector<double>(1000, mpi::rank()), partner, 5);
+        auto value_sent = engine.send(mpi::rank() + 1, partner, 6);
+
+        received.wait();
+        value_received.wait();
+        sent.wait();
+        value_sent.wait();
+
+        REQUIRE(incoming.front() == static_cast<double>(previous));
+        REQUIRE(incoming.back() == static_cast<double>(previous));
+        REQUIRE(value == previous + 1);
+    }
+}
@@ -4,7 +4,11 @@
 #include <catch.hpp>
 
 #include "mpi.hpp"
+#include "mpi/compression.hpp"
 
+#include <array>
+#include <complex>
+#include <cstdint>
 #include <iostream>
 #include <numeric>
 
@@ -95,6 +99,89 @@ TEST_CASE("Point to point synchronous communication")
         }
     }
 }
+/// Point with three coordinates sent as a single contiguous element
+struct point
+{
+    double x, y, z;
+};
+
+namespace mpi
+{
+template <>
+struct data_type<point> : contiguous_data_type<double, 3>
+{
+};
+}
+
+static_assert(mpi::detail::has_data_type<std::uint8_t>::value, "fixed width integers");
+static_assert(mpi::detail::has_data_type<std::array<std::complex<float>, 2>>::value, "arrays");
+static_assert(!mpi::detail::has_data_type<std::vector<int>>::value, "containers");
+
+TEST_CASE("Point to point data types")
+{
+    SECTION("integers")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::blocking{}, true, 1);
+            mpi::send(mpi::blocking{}, std::int8_t{-7}, 1);
+            mpi::send(mpi::blocking{}, std::uint16_t{65000}, 1);
+            mpi::send(mpi::blocking{}, std::uint32_t{4000000000u}, 1);
+            mpi::send(mpi::blocking{}, 5000000000l, 1);
+            mpi::send(mpi::blocking{}, std::vector<std::uint64_t>(5, 1ull << 63), 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<bool>(0));
+            REQUIRE(mpi::receive<std::int8_t>(0) == -7);
+            REQUIRE(mpi::receive<std::uint16_t>(0) == 65000);
+            REQUIRE(mpi::receive<std::uint32_t>(0) == 4000000000u);
+            REQUIRE(mpi::receive<long>(0) == 5000000000l);
+            REQUIRE(mpi::receive<std::vector<std::uint64_t>>(0)
+                    == std::vector<std::uint64_t>(5, 1ull << 63));
+        }
+    }
+    SECTION("complex")
+    {
+        std::vector<std::complex<double>> const values{{1.0, -1.0}, {0.5, 2.0}};
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::blocking{}, std::complex<float>(1.0f, 2.0f), 1);
+            mpi::send(mpi::blocking{}, values, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::complex<float>>(0) == std::complex<float>(1.0f, 2.0f));
+            REQUIRE(mpi::receive<std::vector<std::complex<double>>>(0) == values);
+        }
+    }
+    SECTION("fixed size aggregates")
+    {
+        std::vector<std::array<double, 3>> const coordinates{{{1.0, 2.0, 3.0}}, {{4.0, 5.0, 6.0}}};
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::blocking{}, coordinates, 1);
+            mpi::send(mpi::blocking{}, std::array<int, 2>{{3, 4}}, 1);
+            mpi::send(mpi::blocking{}, std::vector<point>{{1.0, 2.0, 3.0}, {4.0, 5.0, 6.0}}, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<std::array<double, 3>>>(0) == coordinates);
+            REQUIRE((mpi::receive<std::array<int, 2>>(0) == std::array<int, 2>{{3, 4}}));
+
+            auto const points = mpi::receive<std::vector<point>>(0);
+
+            REQUIRE(points.size() == 2);
+            REQUIRE(points[1].x == 4.0);
+            REQUIRE(points[1].z == 6.0);
+        }
+        auto const broadcast = mpi::broadcast(mpi::rank() == 0 ? coordinates
+                                                               : decltype(coordinates)(2));
+        REQUIRE(broadcast == coordinates);
+    }
+}
 TEST_CASE("Point to point asynchronous communication")
 {
     SECTION("float32")
@@ -185,3 +272,213 @@ TEST_CASE("Point to point asynchronous communication")
         }
     }
 }
+TEST_CASE("Point to point send modes")
+{
+    SECTION("synchronous")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::synchronous{}, 2.5, 1);
+            mpi::send(mpi::synchronous{}, std::vector<int>(10, 3), 1);
+
+            std::vector<int> data_to_send(10, 4);
+            mpi::wait(mpi::send(mpi::async{}, mpi::synchronous{}, data_to_send, 1));
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<double>(0) == Approx(2.5));
+            REQUIRE(mpi::receive<std::vector<int>>(0) == std::vector<int>(10, 3));
+            REQUIRE(mpi::receive<std::vector<int>>(0) == std::vector<int>(10, 4));
+        }
+    }
+    SECTION("ready")
+    {
+        std::vector<int> data(10, -1);
+
+        mpi::request request = MPI_REQUEST_NULL;
+        if (mpi::rank() == 1) request = mpi::receive(mpi::async{}, data, 0);
+
+        // The receive must be posted before the ready send starts
+        mpi::barrier();
+
+        if (mpi::rank() == 0)
+        {
+            std::iota(std::begin(data), std::end(data), 0);
+            mpi::send(mpi::ready{}, data, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            mpi::wait(request);
+
+            auto j = 0;
+            for (auto i : data)
+            {
+                REQUIRE(i == j++);
+            }
+        }
+    }
+    SECTION("buffered with a growing pool")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::buffer_pool pool(64);
+
+            REQUIRE_THROWS_AS(mpi::buffer_pool(), std::runtime_error);
+
+            for (int message = 0; message < 8; ++message)
+            {
+                std::vector<int> data_to_send(100, message);
+
+                if (message % 2 == 0)
+                {
+                    mpi::send(mpi::buffered{}, data_to_send, 1, message);
+                }
+                else
+                {
+                    mpi::wait(mpi::send(mpi::async{}, mpi::buffered{}, data_to_send, 1, message));
+                }
+                // The message was copied so the vector can go out of scope
+            }
+            REQUIRE(pool.capacity() >= 100 * sizeof(int));
+        }
+        else if (mpi::rank() == 1)
+        {
+            for (int message = 0; message < 8; ++message)
+            {
+                auto const received = mpi::receive<std::vector<int>>(0, message);
+
+                REQUIRE(received == std::vector<int>(100, message));
+            }
+        }
+    }
+}
+TEST_CASE("Point to point compressed communication")
+{
+    // Smooth field data with a repeated plateau
+    std::vector<double> field(20000);
+    for (std::size_t i = 0; i < field.size(); ++i)
+    {
+        field[i] = i < 10000 ? 1.0 + 1.0e-3 * static_cast<double>(i % 64) : 2.5;
+    }
+
+    SECTION("lz codec")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::compressed{}, field, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<double>>(mpi::compressed{}, 0) == field);
+        }
+    }
+    SECTION("run length codec without shuffle")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::compressed{0, mpi::codec::run_length, false}, field, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<double>>(mpi::compressed{}, 0) == field);
+        }
+    }
+    SECTION("below threshold")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::compressed{}, std::vector<int>{0, 1, 2, 3, 4}, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            auto const received_vector = mpi::receive<std::vector<int>>(mpi::compressed{}, 0);
+
+            REQUIRE(received_vector.size() == 5);
+            for (auto i = 0; i < 5; i++)
+            {
+                REQUIRE(received_vector.at(i) == i);
+            }
+        }
+    }
+    SECTION("empty vector")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::compressed{0}, std::vector<float>{}, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<float>>(mpi::compressed{}, 0).empty());
+        }
+    }
+    SECTION("complex values")
+    {
+        std::vector<std::complex<double>> spectrum(4096, {1.0, -0.5});
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::compressed{}, spectrum, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<std::complex<double>>>(mpi::compressed{}, 0)
+                    == spectrum);
+        }
+    }
+    SECTION("elements wider than 255 bytes")
+    {
+        using block = std::array<double, 40>;
+
+        std::vector<block> blocks(100);
+        for (std::size_t i = 0; i < blocks.size(); ++i) blocks[i].fill(static_cast<double>(i));
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::compressed{0}, blocks, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<block>>(mpi::compressed{}, 0) == blocks);
+        }
+    }
+    SECTION("codec round trip")
+    {
+        // Random bytes are incompressible, runs and repeats are not
+        std::vector<std::uint8_t> bytes(70000);
+        std::uint32_t seed = 12345;
+        for (std::size_t i = 0; i < bytes.size(); ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            bytes[i] = i % 3 == 0 ? static_cast<std::uint8_t>(seed >> 24) : bytes[i / 2];
+        }
+        for (auto const method : {mpi::codec::lz, mpi::codec::run_length})
+        {
+            auto const message = mpi::detail::compress_message(bytes.data(),
+                                                               bytes.size(),
+                                                               1,
+                                                               mpi::compressed{0, method});
+            auto const header = mpi::detail::read_header(message.data());
+
+            std::vector<std::uint8_t> decoded(header.element_count);
+            mpi::detail::decompress_message(message, header, decoded.data());
+
+            REQUIRE(decoded == bytes);
+        }
+    }    SECTION("malformed unencoded header")
+    {
+        std::vector<int> const values{0, 1, 2, 3, 4};
+
+        auto const message = mpi::detail::compress_message(values.data(),
+                                                           values.size(),
+                                                           sizeof(int),
+                                                           mpi::compressed{});
+        auto header = mpi::detail::read_header(message.data());
+
+        // More elements than the payload holds would read past the message
+        header.element_count *= 2;
+
+        std::vector<int> decoded(header.element_count);
+        REQUIRE_THROWS_AS(mpi::detail::decompress_message(message, header, decoded.data()),
+                          std::runtime_error);
+    }
+}
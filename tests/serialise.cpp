@@ -0,0 +1,187 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/serialise.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+TEST_CASE("Flattened containers")
+{
+    SECTION("strings")
+    {
+        std::vector<std::string> const names{"alpha", "", "gamma delta", "e"};
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::flattened{}, names, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<std::string>>(mpi::flattened{}, 0) == names);
+        }
+    }
+    SECTION("jagged vectors")
+    {
+        std::vector<std::vector<double>> const rows{{1.0, 2.0, 3.0}, {}, {4.0}, {5.0, 6.0}};
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::flattened{}, rows, 1);
+            mpi::send(mpi::flattened{}, rows, 1, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            REQUIRE(mpi::receive<std::vector<std::vector<double>>>(mpi::flattened{}, 0) == rows);
+
+            auto const view = mpi::receive<mpi::jagged_view<double>>(mpi::flattened{}, 0, 1);
+
+            REQUIRE(view.size() == rows.size());
+            for (std::size_t row = 0; row < rows.size(); ++row)
+            {
+                REQUIRE(std::vector<double>(view[row].begin(), view[row].end()) == rows[row]);
+            }
+            REQUIRE(view[1].empty());
+            REQUIRE(view[3][1] == 6.0);
+        }
+    }
+    SECTION("aligned view")
+    {
+        // Three rows give a header of 40 bytes, which is padded for long double
+        std::vector<std::vector<long double>> const rows{{1.0L}, {2.0L, 3.0L}, {}};
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::flattened{}, rows, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            auto const view = mpi::receive<mpi::jagged_view<long double>>(mpi::flattened{}, 0);
+
+            REQUIRE(view.size() == 3);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(view[0].data()) % alignof(long double) == 0);
+            REQUIRE(view[0][0] == 1.0L);
+            REQUIRE(view[1][1] == 3.0L);
+        }
+    }
+    SECTION("maps and deeper nesting")
+    {
+        std::map<std::string, std::vector<int>> const table{{"empty", {}},
+                                                            {"primes", {2, 3, 5, 7}},
+                                                            {"one", {1}}};
+
+        std::vector<std::vector<std::string>> const sentences{{"a", "bc"}, {}, {"def"}};
+
+        std::list<std::set<short>> const groups{{3, 1, 2}, {}, {-4}};
+
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::flattened{}, table, 1);
+            mpi::send(mpi::flattened{}, sentences, 1);
+            mpi::send(mpi::flattened{}, groups, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            using table_type = std::map<std::string, std::vector<int>>;
+
+            REQUIRE(mpi::receive<table_type>(mpi::flattened{}, 0) == table);
+            REQUIRE(mpi::receive<std::vector<std::vector<std::string>>>(mpi::flattened{}, 0)
+                    == sentences);
+            REQUIRE(mpi::receive<std::list<std::set<short>>>(mpi::flattened{}, 0) == groups);
+        }
+    }
+    SECTION("broadcast")
+    {
+        std::map<int, std::string> table;
+
+        if (mpi::rank() == 0) table = {{1, "one"}, {2, "two"}, {10, "ten"}};
+
+        auto const broadcast_table = mpi::broadcast(mpi::flattened{}, table);
+
+        REQUIRE(broadcast_table.size() == 3);
+        REQUIRE(broadcast_table.at(10) == "ten");
+    }
+    SECTION("message size limit")
+    {
+        std::size_t const int_limit = std::numeric_limits<int>::max();
+
+        REQUIRE(mpi::detail::message_size(int_limit) == std::numeric_limits<int>::max());
+        REQUIRE_THROWS_AS(mpi::detail::message_size(int_limit + 1), std::runtime_error);
+    }
+    SECTION("type mismatch")
+    {
+        if (mpi::rank() == 0)
+        {
+            mpi::send(mpi::flattened{}, std::vector<std::string>{"abc", "de"}, 1);
+        }
+        else if (mpi::rank() == 1)
+        {
+            // The strings of two and three characters are not whole doubles
+            REQUIRE_THROWS_AS(mpi::receive<std::vector<std::vector<double>>>(mpi::flattened{}, 0),
+                              std::runtime_error);
+        }
+    }
+    SECTION("corrupted header")
+    {
+        std::vector<std::vector<double>> const rows{{1.0, 2.0, 3.0}, {}, {4.0}, {5.0, 6.0}};
+
+        auto const packed = mpi::detail::pack(rows);
+
+        // Overwrite the offset of the end of the first row, which follows
+        // the element count and the offset of the first row
+        auto const corrupted = [&](mpi::detail::flat_size const end_of_first) {
+            mpi::detail::message_storage storage(packed.size());
+            std::memcpy(storage.data(), packed.data(), packed.size());
+            std::memcpy(storage.data() + 2 * sizeof(mpi::detail::flat_size),
+                        &end_of_first,
+                        sizeof(mpi::detail::flat_size));
+            return storage;
+        };
+
+        using rows_type = std::vector<std::vector<double>>;
+
+        // An offset past the end of the message
+        REQUIRE_THROWS_AS(mpi::detail::from_message<rows_type>(corrupted(packed.size() + 8)),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(mpi::jagged_view<double>(corrupted(packed.size() + 8)),
+                          std::runtime_error);
+
+        // An offset past the end of the second row
+        REQUIRE_THROWS_AS(mpi::detail::from_message<rows_type>(corrupted(packed.size() - 8)),
+                          std::runtime_error);
+        REQUIRE_THROWS_AS(mpi::jagged_view<double>(corrupted(packed.size() - 8)),
+                          std::runtime_error);
+    }
+}
@@ -0,0 +1,180 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/sort.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+struct record
+{
+    int key;
+    double value;
+};
+
+/// Check the local data is sorted and ordered with respect to the previous
+/// process holding data by comparing the arithmetic \p key of the boundary
+/// values with \p key_compare, the ordering of the keys
+template <typename T, typename Compare, typename Key, typename Key_Compare>
+void check_globally_sorted(std::vector<T> const& data,
+                           Compare compare,
+                           Key key,
+                           Key_Compare key_compare)
+{
+    REQUIRE(std::is_sorted(begin(data), end(data), compare));
+
+    using key_type = decltype(key(data.front()));
+
+    auto const has_data = mpi::all_gather(static_cast<int>(!data.empty()));
+    auto const backs = mpi::all_gather(data.empty() ? key_type{} : key(data.back()));
+
+    if (data.empty()) return;
+
+    for (auto previous = mpi::rank() - 1; previous >= 0; --previous)
+    {
+        if (!has_data.at(previous)) continue;
+
+        REQUIRE_FALSE(key_compare(key(data.front()), backs.at(previous)));
+        break;
+    }
+}
+
+TEST_CASE("Distributed sample sort")
+{
+    std::mt19937 generator(42 + mpi::rank());
+
+    SECTION("Integers")
+    {
+        std::uniform_int_distribution<int> distribution(-1000, 1000);
+
+        std::vector<int> data(100000);
+        std::generate(begin(data), end(data), [&] { return distribution(generator); });
+
+        auto const local_sum = std::accumulate(begin(data), end(data), 0ll);
+        auto const total_size = mpi::all_reduce(static_cast<int>(data.size()), mpi::sum{});
+
+        auto const timings = mpi::sort(data);
+
+        REQUIRE(timings.total() >= 0.0);
+        REQUIRE(mpi::all_reduce(static_cast<int>(data.size()), mpi::sum{}) == total_size);
+        REQUIRE(mpi::all_reduce(std::accumulate(begin(data), end(data), 0ll), mpi::sum{})
+                == mpi::all_reduce(local_sum, mpi::sum{}));
+
+        check_globally_sorted(data,
+                              std::less<int>{},
+                              [](int value) { return value; },
+                              std::less<int>{});
+    }
+    SECTION("Descending doubles with reused buffers")
+    {
+        std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+        mpi::sample_sorter<double, std::greater<double>> sorter;
+
+        for (auto repeat = 0; repeat < 3; ++repeat)
+        {
+            std::vector<double> data(1000 * (repeat + 1));
+            std::generate(begin(data), end(data), [&] { return distribution(generator); });
+
+            sorter.sort(data);
+
+            check_globally_sorted(data,
+                                  std::greater<double>{},
+                                  [](double value) { return value; },
+                                  std::greater<double>{});
+        }
+    }
+    SECTION("Structures with a custom comparator")
+    {
+        std::uniform_int_distribution<int> distribution(0, 50);
+
+        std::vector<record> data(500);
+        for (auto& entry : data)
+        {
+            entry.key = distribution(generator);
+            entry.value = static_cast<double>(entry.key) * 0.5;
+        }
+
+        auto const by_key = [](record const& lhs, record const& rhs) { return lhs.key < rhs.key; };
+
+        mpi::sort(data, by_key);
+
+        check_globally_sorted(data,
+                              by_key,
+                              [](record const& entry) { return entry.key; },
+                              std::less<int>{});
+
+        for (auto const& entry : data)
+        {
+            REQUIRE(entry.value == entry.key * 0.5);
+        }
+    }
+    SECTION("Unevenly sized inputs")
+    {
+        // The first process holds most of the values, all below those held by
+        // the other processes, so unweighted samples would place the splitters
+        // at the boundary and send nearly everything to the first process
+        std::uniform_int_distribution<int> distribution(0, 999);
+
+        std::vector<int> data(mpi::rank() == 0 ? 20000 : 100);
+        std::generate(begin(data), end(data), [&, offset = mpi::rank() == 0 ? 0 : 1000] {
+            return offset + distribution(generator);
+        });
+
+        auto const total_size = mpi::all_reduce(static_cast<int>(data.size()), mpi::sum{});
+
+        mpi::sort(data);
+
+        REQUIRE(mpi::all_reduce(static_cast<int>(data.size()), mpi::sum{}) == total_size);
+        REQUIRE(mpi::all_reduce(static_cast<int>(data.size()), mpi::max{})
+                <= 5 * total_size / (4 * mpi::size()));
+
+        check_globally_sorted(data,
+                              std::less<int>{},
+                              [](int value) { return value; },
+                              std::less<int>{});
+    }
+    SECTION("Empty data on one process")
+    {
+        std::vector<int> data;
+        if (mpi::rank() == mpi::size() - 1) data = {5, 3, 9, 1, 7};
+
+        mpi::sort(data);
+
+        REQUIRE(mpi::all_reduce(static_cast<int>(data.size()), mpi::sum{}) == 5);
+
+        check_globally_sorted(data,
+                              std::less<int>{},
+                              [](int value) { return value; },
+                              std::less<int>{});
+    }
+}
@@ -0,0 +1,99 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/task_pool.hpp"
+
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv);
+
+    return session.run();
+}
+
+/// Node of a binary tree numbered in breadth first order
+struct tree_node
+{
+    long long index;
+    int depth;
+};
+
+/// Spin for a short time to stand in for the work of a task
+void work()
+{
+    auto const start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::microseconds(20))
+    {
+    }
+}
+
+TEST_CASE("Work stealing task pool")
+{
+    int const maximum_depth = 10;
+    long long const tree_size = (1ll << (maximum_depth + 1)) - 1;
+
+    mpi::task_pool<tree_node> pool(64);
+
+    long long index_sum = 0;
+
+    auto const expand = [&](tree_node const& node) {
+        work();
+        index_sum += node.index;
+        if (node.depth < maximum_depth)
+        {
+            pool.push({2 * node.index + 1, node.depth + 1});
+            pool.push({2 * node.index + 2, node.depth + 1});
+        }
+    };
+
+    SECTION("Tasks created on a single process")
+    {
+        if (mpi::rank() == 0) pool.push({0, 0});
+
+        pool.run(expand);
+
+        auto const executed = static_cast<long long>(pool.statistics().executed);
+
+        REQUIRE(mpi::all_reduce(executed, mpi::sum{}) == tree_size);
+        REQUIRE(mpi::all_reduce(index_sum, mpi::sum{}) == tree_size * (tree_size - 1) / 2);
+    }
+    SECTION("Repeated runs with tasks on every process")
+    {
+        for (int repeat = 0; repeat < 3; ++repeat)
+        {
+            index_sum = 0;
+
+            // Each process owns every size()-th subtree below the root
+            for (long long index = 1 + mpi::rank(); index <= 2; index += mpi::size())
+            {
+                pool.push({index, 1});
+            }
+
+            pool.run(expand);
+
+            REQUIRE(mpi::all_reduce(index_sum, mpi::sum{}) == tree_size * (tree_size - 1) / 2);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+
+#define CATCH_CONFIG_RUNNER
+
+#include <catch.hpp>
+
+#include "mpi.hpp"
+#include "mpi/threading.hpp"
+
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    Catch::Session session;
+
+    // writing to session.configData() here sets defaults
+    // this is the preferred way to set them
+
+    int returnCode = session.applyCommandLine(argc, argv);
+
+    if (returnCode != 0)
+    {
+        return returnCode;
+    }
+
+    // writing to session.configData() or session.Config() here
+    // overrides command line args
+    // only do this if you know you need to
+
+    mpi::instance instance(argc, argv, mpi::thread::multiple);
+
+    return session.run();
+}
+
+/// Each thread exchanges a vector with the thread of the same index on the
+/// neighbouring processes, all using the same tag
+void exchange_from_threads(mpi::thread_communicator& comm)
+{
+    auto const partner = (mpi::rank() + 1) % mpi::size();
+    auto const previous = (mpi::rank() + mpi::size() - 1) % mpi::size();
+
+    std::vector<int> correct(comm.threads(), 0);
+    std::atomic<int> finished{0};
+
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < comm.threads(); ++thread)
+    {
+        workers.emplace_back([&, thread] {
+            std::vector<double> outgoing(500, 100.0 * mpi::rank() + thread);
+            std::vector<double> incoming(500, -1.0);
+
+            auto received = comm.receive(thread, incoming, previous, 4);
+            auto sent = comm.send(thread, outgoing, partner, 4);
+
+            sent.wait();
+            auto const receive_status = received.wait();
+
+            correct[thread] = receive_status.MPI_SOURCE == previous
+                              && std::all_of(begin(incoming), end(incoming), [&](double value) {
+                                     return value == 100.0 * previous + thread;
+                                 });
+            ++finished;
+        });
+    }
+
+    comm.progress_until([&] { return finished.load() == comm.threads(); });
+
+    for (auto& worker : workers) worker.join();
+
+    REQUIRE(std::all_of(begin(correct), end(correct), [](int c) { return c == 1; }));
+}
+
+TEST_CASE("Thread level selection")
+{
+    REQUIRE(mpi::select_threading_path(mpi::thread::multiple)
+            == mpi::threading_path::per_thread_communicators);
+    REQUIRE(mpi::select_threading_path(mpi::thread::serialised) == mpi::threading_path::funnel);
+    REQUIRE(mpi::select_threading_path(mpi::thread::funnelled) == mpi::threading_path::funnel);
+
+    mpi::thread_communicator comm(2);
+    REQUIRE(comm.path() == mpi::select_threading_path(mpi::thread_level()));
+}
+
+TEST_CASE("Communication from many threads")
+{
+    SECTION("Funnel")
+    {
+        mpi::thread_communicator comm(4, mpi::threading_path::funnel);
+
+        exchange_from_threads(comm);
+
+        // The creating thread drives its own operations while waiting
+        int value = mpi::rank(), received = -1;
+        auto receive_request = comm.receive(0, received, (mpi::rank() + 1) % mpi::size());
+        comm.send(0, value, (mpi::rank() + mpi::size() - 1) % mpi::size()).wait();
+        receive_request.wait();
+
+        REQUIRE(received == (mpi::rank() + 1) % mpi::size());
+
+        // Wildcard tags and unknown threads would match other threads' messages
+        REQUIRE_THROWS_AS(comm.receive(0, received, 0, MPI_ANY_TAG), std::runtime_error);
+        REQUIRE_THROWS_AS(comm.send(4, value, 0), std::runtime_error);
+        REQUIRE_THROWS_AS(comm.receive(-1, received, 0), std::runtime_error);
+
+        // The encoded tag of the last thread must not exceed MPI_TAG_UB
+        auto const largest_tag = (mpi::tag_upper_bound() - 3) / 4;
+        REQUIRE_THROWS_AS(comm.send(3, value, 0, largest_tag + 1), std::runtime_error);
+    }
+    if (mpi::thread_level() == mpi::thread::multiple)
+    {
+        SECTION("Per thread communicators")
+        {
+            mpi::thread_communicator comm(4, mpi::threading_path::per_thread_communicators);
+
+            exchange_from_threads(comm);
+        }
+    }
+}